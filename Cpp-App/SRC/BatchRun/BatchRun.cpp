@@ -0,0 +1,105 @@
+#include "BatchRun.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "../../Include/nlohmann/json.hpp"
+#include "../DC/Circuit.hpp"
+#include "../DC/Input.hpp"
+#include "../DC/Parallel.hpp"
+using json = nlohmann::json;
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> batch_inputs(const std::string &path)
+{
+  std::vector<std::string> files;
+  std::error_code error;
+  if (fs::is_directory(path, error))
+  {
+    for (auto it = fs::directory_iterator(path, error); !error && it != fs::directory_iterator(); it.increment(error))
+      if (InputFile::is_netlist(it->path().string()) && it->is_regular_file(error))
+        files.push_back(it->path().string());
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+
+  std::ifstream list(path);
+  std::string line;
+  while (std::getline(list, line))
+  {
+    line.erase(0, line.find_first_not_of(" \t"));
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (!line.empty() && line[0] != '#')
+      files.push_back(line);
+  }
+  return files;
+}
+
+//Load and solve one netlist, the circuit only lives for the duration of the call
+static json solve_file(const std::string &file, const BatchOptions &options)
+{
+  json result = {{"file", file}};
+  try
+  {
+    Circuit circuit;
+    circuit.set_backend(options.backend);
+    circuit.set_mixed_precision(options.mixed_precision);
+    circuit.set_cache(options.cache);
+    circuit.load_json(file);
+    if (circuit.nodes().empty())
+    {
+      result["error"] = "no nodes";
+      return result;
+    }
+    if (!circuit.solve())
+    {
+      result["error"] = "solution not found";
+      return result;
+    }
+
+    json nodes = json::object();
+    json sources = json::object();
+    for (auto node : circuit.nodes()) nodes[node->name()] = node->voltage();
+    for (auto element : circuit.elements())
+      if (element->type() == Type::VOLTAGE_SUPPLY)
+        sources[element->name()] = static_cast<VoltageSource *>(element)->get_current();
+      else if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE)
+        sources[element->name()] = static_cast<DependentSource *>(element)->get_current();
+    result["nodes"] = std::move(nodes);
+    result["sources"] = std::move(sources);
+  }
+  catch (const std::exception &e)
+  {
+    result["error"] = e.what();
+  }
+  return result;
+}
+
+size_t run_batch(const std::vector<std::string> &files, const BatchOptions &options, std::ostream &out)
+{
+  auto start = std::chrono::steady_clock::now();
+  const size_t threads = parallel_threads(files.size(), options.threads);
+
+  //Files differ in size, so workers pull the next index instead of owning a fixed slice
+  std::vector<json> results(files.size());
+  std::atomic<size_t> failed(0);
+  auto work = [&](size_t i, size_t)
+  {
+    results[i] = solve_file(files[i], options);
+    if (results[i].contains("error"))
+      failed++;
+  };
+  parallel_for(files.size(), threads, work);
+
+  //Timing goes to stderr so that the document of two runs can be diffed
+  json document = {{"circuits", std::move(results)}, {"solved", files.size() - failed}, {"failed", failed.load()}};
+  out << document.dump(1, ' ', false, json::error_handler_t::replace) << "\n";
+  std::cerr << "Solved " << files.size() - failed << " of " << files.size() << " circuits on " << threads << " threads in "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+  return failed;
+}
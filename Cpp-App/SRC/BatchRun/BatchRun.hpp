@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../DC/Cache.hpp"
+#include "../DC/Solver.hpp"
+
+/**
+ * @struct BatchOptions
+ * @brief How run_batch loads and solves the netlists.
+ */
+struct BatchOptions
+{
+  size_t threads = 0;                  ///< Worker threads, 0 for one per hardware thread
+  Backend backend = Backend::AUTO;     ///< Backend of every circuit
+  bool mixed_precision = false;        ///< Mixed precision factorization for every circuit
+  const ResultCache *cache = nullptr;  ///< Result cache shared by the workers, nullptr when off
+};
+
+/**
+ * @brief Lists the netlists of a batch.
+ * @param path Directory, whose *.json files are taken in name order, or a text file with one netlist path per line
+ * (blank lines and lines starting with # are skipped).
+ * @return Paths of the netlists, empty if path is neither.
+ */
+std::vector<std::string> batch_inputs(const std::string &path);
+
+/**
+ * @brief Loads and solves every netlist on a pool of threads, each taking the next unsolved file when it is done, and
+ * writes one JSON document with the node voltages and voltage source currents of every circuit, in input order.
+ * A netlist that fails to parse or solve is reported in the document with its error and does not stop the batch.
+ * @param files Paths of the netlists.
+ * @param options Threads and solver settings.
+ * @param out Stream receiving the JSON document.
+ * @return Number of circuits that failed.
+ */
+size_t run_batch(const std::vector<std::string> &files, const BatchOptions &options, std::ostream &out);
@@ -0,0 +1,177 @@
+#include "Batch.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Circuit.hpp"
+
+using LaneRow = Eigen::Array<double, 1, BatchSolver::lanes>;
+
+//Coefficient of a matrix stamp in every lane
+static LaneRow lane_coefficient(const MatrixStamp &stamp, const BatchSolver::LaneBlock &params)
+{
+  switch (stamp.kind)
+  {
+    case StampKind::CONDUCTANCE: return stamp.sign * params.row(stamp.element).inverse();
+    case StampKind::VALUE: return stamp.sign * params.row(stamp.element);
+    case StampKind::COMPLEMENT: return stamp.sign * (1.0 - params.row(stamp.element));
+    default: return LaneRow::Constant(stamp.sign);
+  }
+}
+
+BatchSolver::BatchSolver(Circuit &circuit) : _num_slots(0)
+{
+  circuit.set_ground();
+  _stamps = circuit.build_stamps();
+  const auto &elements = circuit.elements();
+  _nominal.resize(elements.size());
+  for (size_t i = 0; i < elements.size(); i++) _nominal(i) = elements[i]->value();
+
+  const size_t n = _stamps.size;
+
+  //Choose the pivots once with a partial pivoting LU of the nominal system, every instance reuses that row order
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(n, n);
+  for (auto &stamp : _stamps.matrix) A(stamp.row, stamp.col) += stamp_coefficient(stamp.kind, stamp.sign, _nominal(stamp.element));
+  Eigen::PartialPivLU<Eigen::MatrixXd> lu(A);
+  _row_position.resize(n);
+  for (size_t i = 0; i < n; i++) _row_position[i] = lu.permutationP().indices()(i);
+
+  //Symbolic elimination of the pivoted pattern gives the fill-in, and with it every slot the schedule touches
+  Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic> pattern = Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic>::Constant(n, n, false);
+  for (auto &stamp : _stamps.matrix) pattern(_row_position[stamp.row], stamp.col) = true;
+  for (size_t k = 0; k < n; k++)
+  {
+    pattern(k, k) = true;
+    for (size_t i = k + 1; i < n; i++)
+      if (pattern(i, k))
+        for (size_t j = k + 1; j < n; j++) pattern(i, j) = pattern(i, j) || pattern(k, j);
+  }
+
+  Eigen::Array<uint32_t, Eigen::Dynamic, Eigen::Dynamic> slot(n, n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      if (pattern(i, j))
+        slot(i, j) = _num_slots++;
+
+  _matrix_slots.reserve(_stamps.matrix.size());
+  for (auto &stamp : _stamps.matrix) _matrix_slots.push_back(slot(_row_position[stamp.row], stamp.col));
+
+  _scale_begin.reserve(n + 1);
+  _update_begin.reserve(n + 1);
+  _backward_begin.reserve(n + 1);
+  for (size_t k = 0; k < n; k++)
+  {
+    _pivots.push_back(slot(k, k));
+    _scale_begin.push_back(_scales.size());
+    _update_begin.push_back(_updates.size());
+    _backward_begin.push_back(_backward.size());
+    for (size_t i = k + 1; i < n; i++)
+    {
+      if (!pattern(i, k))
+        continue;
+      _scales.push_back(slot(i, k));
+      _forward.push_back({uint32_t(i), slot(i, k), uint32_t(k)});
+      for (size_t j = k + 1; j < n; j++)
+        if (pattern(k, j))
+          _updates.push_back({slot(i, j), slot(i, k), slot(k, j)});
+    }
+    for (size_t j = k + 1; j < n; j++)
+      if (pattern(k, j))
+        _backward.push_back({uint32_t(k), slot(k, j), uint32_t(j)});
+  }
+  _scale_begin.push_back(_scales.size());
+  _update_begin.push_back(_updates.size());
+  _backward_begin.push_back(_backward.size());
+}
+
+size_t BatchSolver::solve(const Eigen::MatrixXd &values, Eigen::MatrixXd &solutions) const
+{
+  const size_t n = _stamps.size;
+  const Eigen::Index count = values.cols();
+  if (size_t(values.rows()) != num_parameters())
+  {
+    std::cerr << "Error: Batch values have " << values.rows() << " rows, expected " << num_parameters() << "\n";
+    solutions.resize(0, 0);
+    return 0;
+  }
+  solutions.resize(n, count);
+
+  LaneBlock params(num_parameters(), lanes);
+  LaneBlock factors(_num_slots, lanes);
+  LaneBlock inverse_pivots(n, lanes);
+  LaneBlock x(n, lanes);
+  LaneBlock residual(n, lanes);
+  LaneBlock scale(n, lanes);
+  size_t fallbacks = 0;
+
+  for (Eigen::Index first = 0; first < count; first += lanes)
+  {
+    const Eigen::Index width = std::min<Eigen::Index>(lanes, count - first);
+    //A partial block is padded with the nominal instance so that every lane stays finite
+    for (Eigen::Index lane = 0; lane < lanes; lane++) params.col(lane) = lane < width ? values.col(first + lane) : _nominal;
+
+    //Stamp A straight into the factor storage
+    factors.setZero();
+    for (size_t t = 0; t < _stamps.matrix.size(); t++) factors.row(_matrix_slots[t]) += lane_coefficient(_stamps.matrix[t], params);
+
+    //Right looking LU without pivoting on the pre-pivoted rows
+    for (size_t k = 0; k < n; k++)
+    {
+      inverse_pivots.row(k) = factors.row(_pivots[k]).inverse();
+      for (uint32_t s = _scale_begin[k]; s < _scale_begin[k + 1]; s++) factors.row(_scales[s]) *= inverse_pivots.row(k);
+      for (uint32_t u = _update_begin[k]; u < _update_begin[k + 1]; u++)
+      {
+        const Update &update = _updates[u];
+        factors.row(update.target) -= factors.row(update.left) * factors.row(update.right);
+      }
+    }
+
+    //Z in pivoted row order, then L y = P Z and U x = y
+    x.setZero();
+    for (auto &stamp : _stamps.sources) x.row(_row_position[stamp.row]) += stamp.sign * params.row(stamp.element);
+    for (const Update &step : _forward) x.row(step.target) -= factors.row(step.left) * x.row(step.right);
+    for (size_t k = n; k-- > 0;)
+    {
+      for (uint32_t b = _backward_begin[k]; b < _backward_begin[k + 1]; b++)
+        x.row(k) -= factors.row(_backward[b].left) * x.row(_backward[b].right);
+      x.row(k) *= inverse_pivots.row(k);
+    }
+
+    //Componentwise backward error |Z - A x| <= tol * (|A| |x| + |Z|) catches lanes where the shared pivots were poor
+    residual.setZero();
+    scale.setZero();
+    for (auto &stamp : _stamps.sources)
+    {
+      residual.row(stamp.row) += stamp.sign * params.row(stamp.element);
+      scale.row(stamp.row) += params.row(stamp.element).abs();
+    }
+    for (auto &stamp : _stamps.matrix)
+    {
+      LaneRow term = lane_coefficient(stamp, params) * x.row(stamp.col);
+      residual.row(stamp.row) -= term;
+      scale.row(stamp.row) += term.abs();
+    }
+    Eigen::Array<bool, 1, lanes> accurate = ((residual.abs() - 1e-10 * scale) <= 0).colwise().all() && x.isFinite().colwise().all();
+
+    for (Eigen::Index lane = 0; lane < width; lane++)
+    {
+      if (accurate(lane))
+        solutions.col(first + lane) = x.col(lane);
+      else
+      {
+        solutions.col(first + lane) = solve_single(values.col(first + lane));
+        fallbacks++;
+      }
+    }
+  }
+  return fallbacks;
+}
+
+Eigen::VectorXd BatchSolver::solve_single(const Eigen::VectorXd &values) const
+{
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(_stamps.size, _stamps.size);
+  Eigen::VectorXd Z = Eigen::VectorXd::Zero(_stamps.size);
+  for (auto &stamp : _stamps.matrix) A(stamp.row, stamp.col) += stamp_coefficient(stamp.kind, stamp.sign, values(stamp.element));
+  for (auto &stamp : _stamps.sources) Z(stamp.row) += stamp.sign * values(stamp.element);
+  return A.partialPivLu().solve(Z);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../../Include/Eigen/Dense"
+#include "Stamp.hpp"
+
+class Circuit;
+
+/**
+ * @class BatchSolver
+ * @brief Solves many instances of one circuit that differ only in element values.
+ *
+ * Instances are laid out structure-of-arrays: every entry of the LU factors holds one value per instance, and a single
+ * elimination schedule, derived once from the nominal values, runs over all of them. Each step of the schedule is an
+ * Eigen array operation over `lanes` contiguous doubles, so Eigen's packet math processes several instances per
+ * instruction (AVX2/AVX-512 when compiled with the matching -march).
+ */
+class BatchSolver
+{
+public:
+  static constexpr int lanes = 16;  ///< Instances solved together by one pass of the schedule
+
+  using LaneBlock = Eigen::Array<double, Eigen::Dynamic, lanes, Eigen::RowMajor>;  ///< One row of lanes per entry
+
+private:
+  /**
+     * @struct Update
+     * @brief One step of the schedule: target -= left * right, for every lane.
+     */
+  struct Update
+  {
+    uint32_t target;
+    uint32_t left;
+    uint32_t right;
+  };
+
+  StampList _stamps;                       ///< Contributions of every element, shared by all instances
+  Eigen::VectorXd _nominal;                ///< Values of the elements in the template circuit
+  std::vector<uint32_t> _row_position;     ///< Row of the pivoted system that each row of A moves to
+  std::vector<uint32_t> _matrix_slots;     ///< Slot in the factor storage of each matrix stamp
+  size_t _num_slots;                       ///< Number of structurally non zero entries of L + U, fill-in included
+  std::vector<uint32_t> _pivots;           ///< Slot of U(k, k) for each k
+  std::vector<uint32_t> _scale_begin;      ///< Start of the L(:, k) slots of column k in _scales, size n + 1
+  std::vector<uint32_t> _scales;           ///< Slots of L(i, k), divided by the pivot when column k is eliminated
+  std::vector<uint32_t> _update_begin;     ///< Start of the updates of column k in _updates, size n + 1
+  std::vector<Update> _updates;            ///< Schur complement updates, slots of A(i, j) -= L(i, k) * U(k, j)
+  std::vector<Update> _forward;            ///< Forward substitution, rows of b(i) -= L(i, k) * b(k) (left is a slot)
+  std::vector<uint32_t> _backward_begin;   ///< Start of the row k steps in _backward, size n + 1
+  std::vector<Update> _backward;           ///< Back substitution, rows of x(k) -= U(k, j) * x(j) (left is a slot)
+
+public:
+  /**
+     * @brief Prepares the elimination schedule of a circuit. Sets the ground of the circuit.
+     * @param circuit Template circuit, its element values are used to choose the pivots.
+     */
+  explicit BatchSolver(Circuit &circuit);
+
+  /**
+     * @brief Gets the number of unknowns of every instance.
+     * @return Rows of the solution.
+     */
+  size_t num_unknowns() const { return _stamps.size; }
+
+  /**
+     * @brief Gets the number of values that describe an instance, one per element of the template circuit.
+     * @return Rows of the values matrix.
+     */
+  size_t num_parameters() const { return _nominal.size(); }
+
+  /**
+     * @brief Gets the element values of the template circuit.
+     * @return One value per element, in the order of Circuit::elements().
+     */
+  const Eigen::VectorXd &nominal_values() const { return _nominal; }
+
+  /**
+     * @brief Solves every instance.
+     * @param values One column per instance holding the value of each element, in the order of Circuit::elements(),
+     * num_parameters() rows.
+     * @param solutions Set to one column per instance holding X (node voltages then voltage source currents), empty if
+     * values does not have num_parameters() rows.
+     * @return Number of instances whose pivots were unusable and were re-solved one by one with a pivoting LU.
+     */
+  size_t solve(const Eigen::MatrixXd &values, Eigen::MatrixXd &solutions) const;
+
+private:
+  /**
+     * @brief Solves one instance on its own, for lanes where the shared pivot order breaks down.
+     * @param values Element values of the instance.
+     * @return X of the instance.
+     */
+  Eigen::VectorXd solve_single(const Eigen::VectorXd &values) const;
+};
@@ -0,0 +1,159 @@
+#include "Board.hpp"
+
+#include "../../Include/nlohmann/json.hpp"
+using json = nlohmann::json;
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Input.hpp"
+#include "UnionFind.hpp"
+
+static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+static void unite(std::vector<size_t> &parent, std::vector<size_t> &size, size_t a, size_t b)
+{
+  a = find_root(parent, a);
+  b = find_root(parent, b);
+  if (a == b)
+    return;
+  if (size[a] < size[b])
+    std::swap(a, b);
+  parent[b] = a;
+  size[a] += size[b];
+}
+
+//Grid point packed into one key, coordinates may be negative
+static uint64_t point_key(long x, long y) { return (uint64_t(uint32_t(int32_t(x))) << 32) | uint32_t(int32_t(y)); }
+
+//Side of a wire end, from the wire or else from its end segment, empty if neither names one
+static std::string end_side(const json &wire, const char *side_key, const json &segment)
+{
+  for (const json &side : {wire.value(side_key, json()), segment.value("terminal", json())})
+    if (side == "__left__" || side == "__right__")
+      return side.get<std::string>();
+  return "";
+}
+
+Circuit BoardImporter::load(const std::string &file_path)
+{
+  InputFile f(file_path);
+  json Json = json::parse(f);
+  const json &elements = Json["elements"];
+  const json &wires = Json.contains("wires") ? Json["wires"] : json::array();
+  const size_t count = elements.size();
+
+  //Entries 2i and 2i + 1 are the left and right terminals of element i, free wire ends follow
+  std::vector<size_t> parent(2 * count);
+  std::vector<size_t> size(2 * count, 1);
+  for (size_t i = 0; i < parent.size(); i++) parent[i] = i;
+  std::unordered_map<long, size_t> index;
+  std::unordered_map<uint64_t, size_t> terminals;
+  index.reserve(count);
+  terminals.reserve(2 * count);
+  for (size_t i = 0; i < count; i++)
+  {
+    const json &element = elements[i];
+    index.emplace(element["id"].get<long>(), i);
+    long x = element["gridX"];
+    long y = element["gridY"];
+    for (size_t side = 0; side < 2; side++)
+    {
+      auto [point, inserted] = terminals.emplace(point_key(x + long(side), y), 2 * i + side);
+      if (!inserted)
+        unite(parent, size, point->second, 2 * i + side);
+    }
+    //A wire element shorts its terminals
+    if (element["type"] == "__wire__")
+      unite(parent, size, 2 * i, 2 * i + 1);
+  }
+
+  //Each end of a wire sits on an element terminal or, left in an empty cell, meets the other wires ending there
+  std::unordered_map<uint64_t, size_t> cells;
+  auto wire_end = [&](const json &wire, const char *element_key, const char *side_key, const json &segment)
+  {
+    if (wire.contains(element_key) && !wire[element_key].is_null())
+    {
+      auto element = index.find(wire[element_key].get<long>());
+      std::string side = end_side(wire, side_key, segment);
+      if (element == index.end() || side.empty())
+        return none;
+      return 2 * element->second + (side == "__right__" ? 1 : 0);
+    }
+    auto [cell, inserted] = cells.emplace(point_key(segment["x"], segment["y"]), parent.size());
+    if (inserted)
+    {
+      parent.push_back(parent.size());
+      size.push_back(1);
+    }
+    return cell->second;
+  };
+  for (const json &wire : wires)
+  {
+    const json &segments = wire["segments"];
+    if (segments.empty())
+      continue;
+    size_t begin = wire_end(wire, "beginElement", "beginElementSide", segments.front());
+    size_t end = wire_end(wire, "endElement", "endElementSide", segments.back());
+    if (begin == none || end == none)
+    {
+      std::cerr << "Error: Wire ends on a missing element or terminal in " << file_path << "\n";
+      return Circuit();
+    }
+    unite(parent, size, begin, end);
+  }
+
+  //One node per net an element other than a wire touches, numbered in board order
+  std::vector<size_t> net(parent.size(), none);
+  size_t nets = 0;
+  for (size_t t = 0; t < 2 * count; t++)
+  {
+    size_t root = find_root(parent, t);
+    if (elements[t / 2]["type"] != "__wire__" && net[root] == none)
+      net[root] = nets++;
+  }
+
+  //Netlist type, name prefix and default value of each board type
+  struct Part
+  {
+    std::string type;
+    std::string prefix;
+    double value;
+  };
+  static const std::unordered_map<std::string, Part> parts = {{"__battery__", {"VOLTAGE_SUPPLY", "V", default_battery}},
+                                                              {"__resistor__", {"RESISTOR", "R", default_resistor}},
+                                                              {"__bulb__", {"RESISTOR", "B", default_bulb}},
+                                                              {"__switch__", {"SWITCH", "S", 1.0}},
+                                                              {"__fuse__", {"FUSE", "F", default_fuse}}};
+  Circuit circuit;
+  circuit.reserve(nets, count);
+  for (size_t n = 0; n < nets; n++) circuit.add_node("n" + std::to_string(n));
+  auto node = [&](size_t terminal) { return "n" + std::to_string(net[find_root(parent, terminal)]); };
+  for (size_t i = 0; i < count; i++)
+  {
+    const json &element = elements[i];
+    std::string type = element["type"];
+    std::string id = std::to_string(element["id"].get<long>());
+    if (type == "__wire__")
+      continue;
+    auto part = parts.find(type);
+    double value = part != parts.end() ? part->second.value : 0.0;
+    if (element.contains("value") && element["value"].is_number())
+      value = element["value"];
+    //A battery has its positive terminal on the right
+    size_t pos = type == "__battery__" ? 2 * i + 1 : 2 * i;
+    size_t neg = pos ^ 1;
+    bool added = part != parts.end() &&
+                 circuit.add_element(part->second.type, part->second.prefix + id, node(pos), node(neg), value);
+    if (!added)
+    {
+      std::cerr << "Error: Cannot import element " << id << " of type " << type << " from " << file_path << "\n";
+      return Circuit();
+    }
+  }
+  return circuit;
+}
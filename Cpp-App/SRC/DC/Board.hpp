@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "Circuit.hpp"
+
+/**
+ * @class BoardImporter
+ * @brief Builds the circuit of a board saved by the diagram editor (Board.serialize() in diagram-ui/src/Board.js).
+ *
+ * Every element has a left terminal on the grid line at gridX and a right one at gridX + 1, so neighbours on a row
+ * share a terminal point. A wire joins the terminals (or free cell centres) its two ends sit on; its inner segments
+ * touch nothing, so crossing wires stay apart. Nets are the classes of a union-find over terminals and free wire ends,
+ * with points matched through a hash map, so an import is near-linear in the size of the board. The terminal
+ * connection lists the editor keeps are not read: they go stale when an element is dragged, and the geometry carries
+ * the same information.
+ *
+ * Wire elements are zero-ohm shorts and are merged into the net of their terminals instead of becoming elements. A
+ * battery is a voltage source with its right terminal positive, a bulb a resistor, and a switch or fuse the elements of
+ * the same name. An element's optional "value" overrides the defaults below.
+ */
+class BoardImporter
+{
+public:
+  static constexpr double default_battery = 12.0;     ///< Voltage of a battery without a value
+  static constexpr double default_resistor = 1000.0;  ///< Resistance of a resistor without a value
+  static constexpr double default_bulb = 24.0;        ///< Resistance of a bulb without a value, 6 W at 12 V
+  static constexpr double default_fuse = 1.0;         ///< Rating of a fuse without a value, in amperes
+
+  /**
+     * @brief Builds the circuit of a saved board. Nodes are named n0, n1, ... and elements by a type letter (V, R, B,
+     * S, F) and their board id. Throws nlohmann::json::exception on a missing or malformed file.
+     * @param file_path Path of the JSON file.
+     * @return The circuit, empty if the board names an unknown element type or a wire end on a missing element.
+     */
+  static Circuit load(const std::string &file_path);
+};
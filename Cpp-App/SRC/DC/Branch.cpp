@@ -0,0 +1,92 @@
+#include "Branch.hpp"
+
+#include <algorithm>
+
+#include "Circuit.hpp"
+
+BranchTable::BranchTable(Circuit &circuit) : _num_nodes(circuit.nodes().size())
+{
+  const uint32_t ground = circuit.set_ground()->id();
+  const auto &elements = circuit.elements();
+  const size_t m = elements.size();
+  _pos.resize(m);
+  _neg.resize(m);
+  _conductance.resize(m);
+  _forced.resize(m);
+  _kind.resize(m);
+
+  std::vector<double> values(m);
+  for (size_t i = 0; i < m; i++)
+  {
+    Element *element = elements[i];
+    Node *pos = element->get_pos_node();
+    Node *neg = element->get_neg_node();
+    _pos[i] = pos ? pos->id() : ground;
+    _neg[i] = neg ? neg->id() : ground;
+    values[i] = element->value();
+    //A resistor missing a terminal carries no current, like Resistor::get_current
+    if (element->type() == Type::RESISTOR)
+      _kind[i] = pos && neg ? Kind::CONDUCTANCE : Kind::NONE;
+    else if (element->type() == Type::CURRENT_SOURCE)
+      _kind[i] = Kind::FORCED;
+    else
+      _kind[i] = Kind::NONE;
+    //Currents of sources that do not follow from their own drop come from the solution
+    if (element->type() == Type::VOLTAGE_SUPPLY || element->type() == Type::DEPENDENT_VOLTAGE_SOURCE ||
+        element->type() == Type::DEPENDENT_CURRENT_SOURCE || branch_id(element) >= 0)
+      _sources.push_back(i);
+  }
+  set_values(values.data());
+}
+
+void BranchTable::set_values(const double *values)
+{
+  for (size_t i = 0; i < _kind.size(); i++)
+  {
+    _conductance[i] = _kind[i] == Kind::CONDUCTANCE ? 1.0 / values[i] : 0.0;
+    //Z gets +I at the positive node, so the source pushes I out of its positive terminal
+    _forced[i] = _kind[i] == Kind::FORCED ? -values[i] : 0.0;
+  }
+}
+
+void BranchTable::compute(const double *__restrict voltages, const double *source_currents, double *__restrict drop,
+                          double *__restrict current, double *__restrict power) const
+{
+  const size_t m = _pos.size();
+  const uint32_t *pos = _pos.data();
+  const uint32_t *neg = _neg.data();
+  const double *conductance = _conductance.data();
+  const double *forced = _forced.data();
+
+  //One branch free pass over every element. The buffers are restrict, so with Opt=-O3 and an Arch that has gathers
+  //(AVX2, AVX-512) the compiler vectorizes it, gathering the two node voltages of several elements per instruction
+  for (size_t i = 0; i < m; i++)
+  {
+    double v = voltages[pos[i]] - voltages[neg[i]];
+    double j = conductance[i] * v + forced[i];
+    drop[i] = v;
+    current[i] = j;
+    power[i] = v * j;
+  }
+
+  //Voltage source, inductor and switch currents are unknowns of the system and dependent source currents depend on the
+  //control, all are already in the passive convention
+  for (uint32_t i : _sources)
+  {
+    current[i] = source_currents[i];
+    power[i] = drop[i] * current[i];
+  }
+}
+
+void BranchTable::gather(const Circuit &circuit, std::vector<double> &voltages, std::vector<double> &source_currents) const
+{
+  voltages.resize(_num_nodes);
+  for (auto node : circuit.nodes()) voltages[node->id()] = node->is_ground() ? 0.0 : node->voltage();
+  source_currents.resize(_pos.size());
+  for (uint32_t i : _sources)
+  {
+    const Element *element = circuit.elements()[i];
+    source_currents[i] = element->type() == Type::DEPENDENT_CURRENT_SOURCE ? static_cast<const DependentSource *>(element)->get_current()
+                                                                           : branch_current(element);
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Solution.hpp"
+
+class Circuit;
+
+/**
+ * @class BranchTable
+ * @brief Computes the voltage drop, current and power of every element of a solved circuit in one pass.
+ *
+ * The terminals and values of the elements are copied once into structure-of-arrays form, so the kernel is a straight
+ * loop over contiguous arrays that gathers two node voltages per element and does no pointer chasing or type dispatch;
+ * voltage and dependent sources, whose current is not set by their own drop, are patched in a second loop over their
+ * own short list.
+ * Results follow the passive sign convention: current flows from the positive to the negative terminal through the
+ * element, and power is drop * current, positive when the element absorbs power.
+ */
+class BranchTable
+{
+  /**
+     * @brief How the value of an element enters the kernel.
+     */
+  enum class Kind : uint8_t
+  {
+    CONDUCTANCE,  //Resistor, current = drop / value
+    FORCED,       //Current source, current = -value
+    NONE,         //Voltage source, dependent source or inductor (patched afterwards), capacitor, or resistor missing a terminal
+  };
+
+  std::vector<uint32_t> _pos;          ///< Node::id() of the positive terminal, the ground if unconnected
+  std::vector<uint32_t> _neg;          ///< Node::id() of the negative terminal, the ground if unconnected
+  std::vector<double> _conductance;    ///< 1 / R for resistors, 0 for other elements
+  std::vector<double> _forced;         ///< Current set by the element regardless of the drop, -I for current sources
+  std::vector<Kind> _kind;             ///< How each value turns into _conductance and _forced
+  std::vector<uint32_t> _sources;      ///< Element::index() of every voltage source, dependent source and inductor
+  size_t _num_nodes;                   ///< Number of nodes, ground included
+
+public:
+  /**
+     * @brief Copies the terminals and values of the elements of a circuit. Sets the ground of the circuit.
+     * @param circuit Circuit to describe, its structure must not change while the table is used.
+     */
+  explicit BranchTable(Circuit &circuit);
+
+  /**
+     * @brief Gets the number of elements, the size of every output buffer.
+     * @return Number of elements.
+     */
+  size_t size() const { return _pos.size(); }
+
+  /**
+     * @brief Replaces the element values, after they were changed on the circuit or to post-process an evaluate().
+     * @param values Value of every element, indexed like Circuit::elements().
+     */
+  void set_values(const double *values);
+
+  /**
+     * @brief Computes every branch quantity. Every output holds size() values and must not overlap another buffer.
+     * @param voltages Voltage of every node indexed by Node::id(), 0 for the ground.
+     * @param source_currents Current of every voltage source indexed by Element::index(), like Solution::currents;
+     * only the entries of voltage and dependent sources are read.
+     * @param drop Receives vpos - vneg of every element.
+     * @param current Receives the current through every element, from positive to negative terminal.
+     * @param power Receives the power absorbed by every element.
+     */
+  void compute(const double *voltages, const double *source_currents, double *drop, double *current, double *power) const;
+
+  /**
+     * @brief Computes every branch quantity of a Solution returned by Circuit::evaluate().
+     */
+  void compute(const Solution &solution, double *drop, double *current, double *power) const
+  {
+    compute(solution.voltages.data(), solution.currents.data(), drop, current, power);
+  }
+
+  /**
+     * @brief Copies the node voltages and voltage source currents of a circuit solved with Circuit::solve() into the
+     * layout compute() reads.
+     * @param circuit Solved circuit.
+     * @param voltages Resized to the number of nodes and filled by Node::id().
+     * @param source_currents Resized to the number of elements and filled for the voltage and dependent sources.
+     */
+  void gather(const Circuit &circuit, std::vector<double> &voltages, std::vector<double> &source_currents) const;
+};
@@ -0,0 +1,36 @@
+#include "Builder.hpp"
+
+#include <utility>
+
+CircuitBuilder::CircuitBuilder(size_t nodes, size_t elements) { _circuit.reserve(nodes, elements); }
+
+CircuitBuilder &CircuitBuilder::node(const std::string &name)
+{
+  if (_circuit.get_node(name) == nullptr)
+    _circuit.add_node(name);
+  return *this;
+}
+
+//Both terminals in one call, so that a zero or negative value keeps pos and neg where they were given
+CircuitBuilder &CircuitBuilder::resistor(const std::string &name, const std::string &pos, const std::string &neg, double resistance)
+{
+  node(pos).node(neg);
+  _circuit.add_resistor(name, _circuit.get_node(pos), _circuit.get_node(neg), resistance);
+  return *this;
+}
+
+CircuitBuilder &CircuitBuilder::voltage_source(const std::string &name, const std::string &pos, const std::string &neg, double voltage)
+{
+  node(pos).node(neg);
+  _circuit.add_v_source(name, _circuit.get_node(pos), _circuit.get_node(neg), voltage);
+  return *this;
+}
+
+CircuitBuilder &CircuitBuilder::current_source(const std::string &name, const std::string &pos, const std::string &neg, double current)
+{
+  node(pos).node(neg);
+  _circuit.add_c_source(name, _circuit.get_node(pos), _circuit.get_node(neg), current);
+  return *this;
+}
+
+Circuit CircuitBuilder::build() { return std::exchange(_circuit, Circuit()); }
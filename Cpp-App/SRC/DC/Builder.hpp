@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "Circuit.hpp"
+
+/**
+ * @class CircuitBuilder
+ * @brief Assembles a circuit element by element with both terminals at once, creating nodes on first use, and hands
+ * the result over by move. Meant for generated or imported circuits too large to go through a JSON netlist.
+ *
+ * The circuit is built in place: build() moves it out, so no node or element is ever copied.
+ */
+class CircuitBuilder
+{
+  Circuit _circuit;  ///< Circuit under construction
+
+public:
+  /**
+     * @brief Constructor for CircuitBuilder.
+     * @param nodes Expected number of nodes, reserved up front.
+     * @param elements Expected number of elements, reserved up front.
+     */
+  explicit CircuitBuilder(size_t nodes = 0, size_t elements = 0);
+
+  /**
+     * @brief Adds a node unless one with this name exists.
+     * @param name Name of the node.
+     * @return The builder.
+     */
+  CircuitBuilder &node(const std::string &name);
+
+  /**
+     * @brief Adds a resistor between two nodes.
+     * @param name Name of the resistor.
+     * @param pos Name of the positive node.
+     * @param neg Name of the negative node.
+     * @param resistance Resistance in ohms.
+     * @return The builder.
+     */
+  CircuitBuilder &resistor(const std::string &name, const std::string &pos, const std::string &neg, double resistance);
+
+  /**
+     * @brief Adds a voltage source, pos is at voltage above neg.
+     * @param name Name of the source.
+     * @param pos Name of the positive node.
+     * @param neg Name of the negative node.
+     * @param voltage Voltage in volts.
+     * @return The builder.
+     */
+  CircuitBuilder &voltage_source(const std::string &name, const std::string &pos, const std::string &neg, double voltage);
+
+  /**
+     * @brief Adds a current source, driving current into pos.
+     * @param name Name of the source.
+     * @param pos Name of the positive node.
+     * @param neg Name of the negative node.
+     * @param current Current in amperes.
+     * @return The builder.
+     */
+  CircuitBuilder &current_source(const std::string &name, const std::string &pos, const std::string &neg, double current);
+
+  /**
+     * @brief Hands the circuit over. The builder is empty afterwards and can start a new circuit.
+     * @return The circuit.
+     */
+  Circuit build();
+};
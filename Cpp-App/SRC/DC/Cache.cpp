@@ -0,0 +1,216 @@
+#include "Cache.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static const char cache_magic[8] = {'D', 'C', 'C', 'A', 'C', 'H', 'E', '1'};
+static const char *cache_extension = ".dcc";
+
+//Bytes of an entry: magic, description length, description, value count, values
+static uintmax_t entry_size(uint64_t length, uint64_t count)
+{
+  return sizeof(cache_magic) + 2 * sizeof(uint64_t) + length + count * sizeof(double);
+}
+
+ResultCache::ResultCache(fs::path directory, uintmax_t max_bytes) : _directory(std::move(directory)), _max_bytes(max_bytes), _total(0)
+{
+  std::error_code error;
+  fs::create_directories(_directory, error);
+  if (error)
+  {
+    std::cerr << "Cannot create cache directory " << _directory << ": " << error.message() << "\n";
+    return;
+  }
+
+  //The only scan of the directory, stores and hits keep the index up to date from here on
+  struct Found
+  {
+    uint64_t hash;
+    uintmax_t size;
+    fs::file_time_type used;
+  };
+  std::vector<Found> found;
+  for (auto it = fs::directory_iterator(_directory, error); !error && it != fs::directory_iterator(); it.increment(error))
+  {
+    if (it->path().extension() != cache_extension)
+      continue;
+    std::string name = it->path().stem().string();
+    uint64_t hash = 0;
+    auto [end, parse_error] = std::from_chars(name.data(), name.data() + name.size(), hash, 16);
+    if (name.size() != 16 || parse_error != std::errc() || end != name.data() + name.size())
+      continue;
+    std::error_code entry_error;
+    Found entry{hash, it->file_size(entry_error), it->last_write_time(entry_error)};
+    if (!entry_error)
+      found.push_back(entry);
+  }
+  std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) { return a.used > b.used; });
+  for (const Found &entry : found)
+  {
+    _order.push_back(entry.hash);
+    _index[entry.hash] = {std::prev(_order.end()), entry.size};
+    _total += entry.size;
+  }
+}
+
+uint64_t ResultCache::hash(const std::string &description)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : description)
+  {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+bool ResultCache::load(const std::string &description, size_t count, std::vector<double> &values) const
+{
+  const uint64_t key = hash(description);
+  fs::path path = entry_path(key);
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in)
+    return false;
+  const uintmax_t size = uintmax_t(in.tellg());
+  in.seekg(0);
+
+  //Entry layout: magic, description length, description, value count, values. Another description under the same
+  //hash is a miss, a header that disagrees with the size of the file is a corrupt entry
+  char magic[sizeof(cache_magic)];
+  uint64_t length = 0;
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+      !in.read(reinterpret_cast<char *>(&length), sizeof(length)) || entry_size(length, 0) > size)
+  {
+    drop(key);
+    return false;
+  }
+  if (length != description.size())
+    return false;
+  std::string stored(length, '\0');
+  uint64_t stored_count = 0;
+  if (!in.read(stored.data(), length) || stored != description)
+    return false;
+  if (!in.read(reinterpret_cast<char *>(&stored_count), sizeof(stored_count)) || stored_count != count ||
+      entry_size(length, stored_count) != size)
+  {
+    drop(key);
+    return false;
+  }
+  values.resize(count);
+  if (!in.read(reinterpret_cast<char *>(values.data()), count * sizeof(double)))
+  {
+    drop(key);
+    return false;
+  }
+
+  //Mark the entry as recently used, on disk for later scans and in the index for this process
+  std::error_code error;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+  std::lock_guard<std::mutex> lock(_mutex);
+  touch(key, size);
+  return true;
+}
+
+bool ResultCache::store(const std::string &description, const std::vector<double> &values) const
+{
+  //Write to a private file and rename it in place, so readers in other processes never see half an entry
+  fs::path path = entry_path(description);
+  fs::path temporary = path;
+  temporary += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + "." +
+               std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    uint64_t length = description.size();
+    uint64_t count = values.size();
+    out.write(cache_magic, sizeof(cache_magic));
+    out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    out.write(description.data(), length);
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char *>(values.data()), count * sizeof(double));
+    if (!out)
+    {
+      std::error_code error;
+      fs::remove(temporary, error);
+      return false;
+    }
+  }
+
+  std::error_code error;
+  fs::rename(temporary, path, error);
+  if (error)
+  {
+    fs::remove(temporary, error);
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(_mutex);
+  touch(hash(description), entry_size(description.size(), values.size()));
+  if (_total > _max_bytes)
+    evict_locked();
+  return true;
+}
+
+void ResultCache::evict() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  evict_locked();
+}
+
+void ResultCache::touch(uint64_t hash, uintmax_t size) const
+{
+  auto it = _index.find(hash);
+  if (it != _index.end())
+  {
+    _total -= it->second.size;
+    _order.erase(it->second.position);
+  }
+  _order.push_front(hash);
+  _index[hash] = {_order.begin(), size};
+  _total += size;
+}
+
+void ResultCache::evict_locked() const
+{
+  std::error_code error;
+  while (_total > _max_bytes && !_order.empty())
+  {
+    uint64_t hash = _order.back();
+    fs::remove(entry_path(hash), error);
+    _total -= _index[hash].size;
+    _index.erase(hash);
+    _order.pop_back();
+  }
+}
+
+void ResultCache::drop(uint64_t hash) const
+{
+  std::error_code error;
+  fs::remove(entry_path(hash), error);
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _index.find(hash);
+  if (it == _index.end())
+    return;
+  _total -= it->second.size;
+  _order.erase(it->second.position);
+  _index.erase(it);
+}
+
+fs::path ResultCache::entry_path(const std::string &description) const
+{
+  return entry_path(hash(description));
+}
+
+fs::path ResultCache::entry_path(uint64_t hash) const
+{
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+  return _directory / (std::string(name) + cache_extension);
+}
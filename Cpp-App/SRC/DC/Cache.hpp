@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class ResultCache
+ * @brief Content addressed on-disk store of solutions, shared by every process that points at the same directory.
+ *
+ * An entry is keyed by the hash of a canonical description of a circuit (topology, ground and exact values) and holds
+ * that description next to the solved values, so a hash collision is detected instead of returning a wrong solution.
+ * The directory is kept under a size bound by evicting the least recently used entries. It is scanned once, when the
+ * cache is built, into an in-memory index ordered by modification time; after that stores and hits only update the
+ * index and a running total, and a store evicts only when the total goes over the bound. A hit also refreshes the
+ * entry's modification time, so that the next scan, by this or another process, orders it the same way.
+ */
+class ResultCache
+{
+  struct Indexed
+  {
+    std::list<uint64_t>::iterator position;  ///< Place of the entry in _order
+    uintmax_t size;                          ///< Size of the entry file
+  };
+
+  std::filesystem::path _directory;                      ///< Directory holding one file per entry
+  uintmax_t _max_bytes;                                  ///< Size the directory is trimmed to after a store
+  mutable std::mutex _mutex;                             ///< Guards the index, workers of a batch share one cache
+  mutable std::list<uint64_t> _order;                    ///< Hashes of the entries, most recently used first
+  mutable std::unordered_map<uint64_t, Indexed> _index;  ///< Entries by hash
+  mutable uintmax_t _total;                              ///< Sum of the sizes of the indexed entries
+
+public:
+  /**
+     * @brief Constructor for ResultCache. Creates the directory if needed and indexes the entries it holds.
+     * @param directory Directory of the cache.
+     * @param max_bytes Total size of the entries kept, older entries are evicted beyond it.
+     */
+  explicit ResultCache(std::filesystem::path directory, uintmax_t max_bytes = uintmax_t(64) << 20);
+
+  /**
+     * @brief Hashes a description with 64 bit FNV-1a.
+     * @param description Canonical description of a circuit.
+     * @return Hash naming the entry.
+     */
+  static uint64_t hash(const std::string &description);
+
+  /**
+     * @brief Looks a circuit up. An entry whose size does not match its header or the expected count is corrupt and
+     * is deleted.
+     * @param description Canonical description of the circuit.
+     * @param count Number of values the circuit has.
+     * @param values Set to the stored values on a hit.
+     * @return True on a hit.
+     */
+  bool load(const std::string &description, size_t count, std::vector<double> &values) const;
+
+  /**
+     * @brief Stores the solution of a circuit, then evicts entries beyond the size bound.
+     * @param description Canonical description of the circuit.
+     * @param values Values to store.
+     * @return True if the entry was written.
+     */
+  bool store(const std::string &description, const std::vector<double> &values) const;
+
+  /**
+     * @brief Removes least recently used entries until the indexed ones fit in the size bound.
+     */
+  void evict() const;
+
+private:
+  /**
+     * @brief Records an entry as the most recently used, replacing any previous record of it. Needs _mutex held.
+     * @param hash Hash of the entry.
+     * @param size Size of the entry file.
+     */
+  void touch(uint64_t hash, uintmax_t size) const;
+
+  /**
+     * @brief Removes least recently used entries until the total fits in the size bound. Needs _mutex held.
+     */
+  void evict_locked() const;
+
+  /**
+     * @brief Removes a corrupt entry from the directory and the index.
+     * @param hash Hash of the entry.
+     */
+  void drop(uint64_t hash) const;
+
+  /**
+     * @brief Gets the file of an entry.
+     * @param description Canonical description of the circuit.
+     * @return Path of the entry, named after the hash of the description.
+     */
+  std::filesystem::path entry_path(const std::string &description) const;
+
+  /**
+     * @brief Gets the file of an entry.
+     * @param hash Hash of the description of the circuit.
+     * @return Path of the entry.
+     */
+  std::filesystem::path entry_path(uint64_t hash) const;
+};
@@ -3,10 +3,40 @@
 #include "../../Include/nlohmann/json.hpp"
 using json = nlohmann::json;
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "FixedSize.hpp"
+#include "Generator.hpp"
+#include "Input.hpp"
+#include "UnionFind.hpp"
+
+//A fixed-topology MNA system whose element values are restamped in place
+struct Circuit::CompiledPlan
+{
+  StampList stamps;                   //> Contributions of all elements, emitted element by element
+  Eigen::SparseMatrix<double> A;      //> Compressed A, its pattern never changes
+  Eigen::VectorXd Z;                  //> Right-hand side
+  std::vector<size_t> offsets;        //> Offset of each matrix stamp in A.valuePtr()
+  std::vector<size_t> matrix_begin;   //> First matrix stamp of each element, one more entry than elements
+  std::vector<size_t> source_begin;   //> First source stamp of each element, one more entry than elements
+  std::vector<size_t> slot_begin;     //> First entry of each slot of A in slot_stamps, one more entry than slots
+  std::vector<size_t> slot_stamps;    //> Matrix stamps grouped by the slot of A they add to
+  std::vector<size_t> row_begin;      //> First entry of each row of Z in row_stamps, one more entry than rows
+  std::vector<size_t> row_stamps;     //> Source stamps grouped by the row of Z they add to
+  std::vector<double> stamped;        //> Value each element was last stamped with
+  std::vector<Element *> dirty;       //> Elements whose value changed since the last restamp
+  bool matrix_changed = true;         //> A changed since the last factorization
+  bool factorized = false;            //> The solver holds a factorization of this pattern
+  bool updated = false;               //> That factorization is of the base of _update, A is solved through the update
+};
 
 //Constructor for Circuit
-Circuit::Circuit() : _volt_source_id(0), _node_id(0) {}
+Circuit::Circuit() : _volt_source_id(0), _current_source_id(0), _node_id(0), _ground(nullptr), _pinned_ground(nullptr), _num_node_unknowns(0), _verbose(false), _profiling(false), _compiled(false), _fixed_size(false), _cache(nullptr), _from_cache(false), _components_stale(true), _switch_cache(), _solver_stale(true) {}
 
 //Destructor for Circuit
 Circuit::~Circuit()
@@ -15,38 +45,99 @@ Circuit::~Circuit()
   for (auto element : _elements) delete element;
 }
 
+//Nodes and elements stay where they are on the heap, only the vectors holding them change hands
+Circuit::Circuit(Circuit &&other) noexcept : Circuit() { swap(other); }
+
+//The old contents go out with the temporary
+Circuit &Circuit::operator=(Circuit &&other) noexcept
+{
+  Circuit moved(std::move(other));
+  swap(moved);
+  return *this;
+}
+
+void Circuit::swap(Circuit &other) noexcept
+{
+  std::swap(_nodes, other._nodes);
+  std::swap(_elements, other._elements);
+  std::swap(_node_names, other._node_names);
+  std::swap(_element_names, other._element_names);
+  std::swap(_voltage_sources, other._voltage_sources);
+  std::swap(_current_sources, other._current_sources);
+  std::swap(_dependent_sources, other._dependent_sources);
+  std::swap(_opamps, other._opamps);
+  std::swap(_inductors, other._inductors);
+  std::swap(_switches, other._switches);
+  std::swap(_volt_source_id, other._volt_source_id);
+  std::swap(_current_source_id, other._current_source_id);
+  std::swap(_node_id, other._node_id);
+  std::swap(_ground, other._ground);
+  std::swap(_pinned_ground, other._pinned_ground);
+  std::swap(_columns, other._columns);
+  std::swap(_rows, other._rows);
+  std::swap(_num_node_unknowns, other._num_node_unknowns);
+  std::swap(_verbose, other._verbose);
+  std::swap(_profiling, other._profiling);
+  std::swap(_profile, other._profile);
+  std::swap(_solver, other._solver);
+  std::swap(_compiled, other._compiled);
+  std::swap(_plan, other._plan);
+  std::swap(_fixed_size, other._fixed_size);
+  std::swap(_cache, other._cache);
+  std::swap(_from_cache, other._from_cache);
+  std::swap(_update, other._update);
+  std::swap(_components, other._components);
+  std::swap(_components_stale, other._components_stale);
+  std::swap(_switch_cache, other._switch_cache);
+  std::swap(_solver_key, other._solver_key);
+  std::swap(_solver_stale, other._solver_stale);
+  std::swap(_blown, other._blown);
+}
+
+void Circuit::reserve(size_t nodes, size_t elements)
+{
+  _nodes.reserve(nodes);
+  _node_names.reserve(nodes);
+  _elements.reserve(elements);
+  _element_names.reserve(elements);
+}
+
 //Add a new node to the circuit
-void Circuit::add_node(std::string name) { _nodes.push_back(new Node(_node_id++, name)); }
+void Circuit::add_node(std::string name)
+{
+  invalidate_plan();
+  Node *node = new Node(_node_id++, name);
+  _nodes.push_back(node);
+  _node_names.emplace(node->name(), node);
+  if (!_components_stale)
+    _components.push_back(node->id());
+}
 
 //Retrurn node with the given name
 Node *Circuit::get_node(std::string name)
 {
-  for (auto node : _nodes)
-    if (node->name() == name)
-      return node;
-  return nullptr;
+  auto it = _node_names.find(name);
+  return it == _node_names.end() ? nullptr : it->second;
 }
 
 //Return element with a given name
 Element *Circuit::get_element(std::string name)
 {
-  for (auto element : _elements)
-    if (element->name() == name)
-      return element;
-  return nullptr;
+  auto it = _element_names.find(name);
+  return it == _element_names.end() ? nullptr : it->second;
 }
 
 //Return VoltageSource with a given name
 VoltageSource *Circuit::get_voltage_source(std::string name)
 {
-  for (auto element : _voltage_sources)
-    if (element->name() == name)
-      return static_cast<VoltageSource *>(element);
-  return nullptr;
+  Element *element = get_element(name);
+  return element != nullptr && element->type() == Type::VOLTAGE_SUPPLY ? static_cast<VoltageSource *>(element) : nullptr;
 }
 
 void Circuit::add_resistor(std::string name, std::string node_name, double value)
 {
+  invalidate_plan();
+
   Node *node = get_node(node_name);
 
   // Node should be already present
@@ -64,14 +155,19 @@ void Circuit::add_resistor(std::string name, std::string node_name, double value
     // If resistor is not present, create a new resistor and set pos node
     resistor = new Resistor(name, value);
     resistor->set_pos_node(node);
+    resistor->set_index(_elements.size());
     _elements.push_back(resistor);
+    _element_names.emplace(name, resistor);
   }
   else if (resistor->type() == Type::RESISTOR)
   {
     // If resistor is present and its type is RESISTOR
     // If pos node is set, neg node is not set, and value matches, set neg node
     if (resistor->get_pos_node() != nullptr && resistor->get_neg_node() == nullptr && resistor->value() == value)
+    {
       resistor->set_neg_node(node);
+      join_components(resistor);
+    }
     else
       std::cerr << "Error: Resistor " << name << " already has both nodes assigned or value mismatch\n";
   }
@@ -81,8 +177,28 @@ void Circuit::add_resistor(std::string name, std::string node_name, double value
   }
 }
 
+bool Circuit::add_resistor(std::string name, Node *pos, Node *neg, double value)
+{
+  Resistor *resistor = new Resistor(std::move(name), value);
+  if (!_element_names.emplace(resistor->name(), resistor).second)
+  {
+    std::cerr << "Error: Element " << resistor->name() << " already exists\n";
+    delete resistor;
+    return false;
+  }
+  invalidate_plan();
+  resistor->set_pos_node(pos);
+  resistor->set_neg_node(neg);
+  resistor->set_index(_elements.size());
+  _elements.push_back(resistor);
+  join_components(resistor);
+  return true;
+}
+
 void Circuit::add_v_source(std::string name, std::string node_name, double value)
 {
+  invalidate_plan();
+
   Node *node = get_node(node_name);
 
   // Node should be already present
@@ -103,7 +219,9 @@ void Circuit::add_v_source(std::string name, std::string node_name, double value
       v_source->set_neg_node(node);
     else
       v_source->set_pos_node(node);
+    v_source->set_index(_elements.size());
     _elements.push_back(v_source);
+    _element_names.emplace(name, v_source);
     _voltage_sources.push_back(v_source);
   }
   else if (v_source->type() == Type::VOLTAGE_SUPPLY)
@@ -116,6 +234,7 @@ void Circuit::add_v_source(std::string name, std::string node_name, double value
       v_source->set_pos_node(node);
     else
       std::cerr << "Error: Voltage source " << name << " already has both nodes assigned or value mismatch\n";
+    join_components(v_source);
   }
   else
   {
@@ -123,8 +242,30 @@ void Circuit::add_v_source(std::string name, std::string node_name, double value
   }
 }
 
+bool Circuit::add_v_source(std::string name, Node *pos, Node *neg, double value)
+{
+  VoltageSource *v_source = new VoltageSource(std::move(name), value, _volt_source_id);
+  if (!_element_names.emplace(v_source->name(), v_source).second)
+  {
+    std::cerr << "Error: Element " << v_source->name() << " already exists\n";
+    delete v_source;
+    return false;
+  }
+  invalidate_plan();
+  _volt_source_id++;
+  v_source->set_pos_node(pos);
+  v_source->set_neg_node(neg);
+  v_source->set_index(_elements.size());
+  _elements.push_back(v_source);
+  _voltage_sources.push_back(v_source);
+  join_components(v_source);
+  return true;
+}
+
 void Circuit::add_c_source(std::string name, std::string node_name, double value)
 {
+  invalidate_plan();
+
   Node *node = get_node(node_name);
   // Node should be already present
   if (node == nullptr)
@@ -137,12 +278,14 @@ void Circuit::add_c_source(std::string name, std::string node_name, double value
   if (c_source == nullptr)
   {
     // If current source is not present, create a new current source
-    c_source = new CurrentSource(name, value, _volt_source_id++);
+    c_source = new CurrentSource(name, value, _current_source_id++);
     if (value < 0)
       c_source->set_neg_node(node);
     else
       c_source->set_pos_node(node);
+    c_source->set_index(_elements.size());
     _elements.push_back(c_source);
+    _element_names.emplace(name, c_source);
     _current_sources.push_back(static_cast<CurrentSource *>(c_source));
   }
   else if (c_source->type() == Type::CURRENT_SOURCE)
@@ -162,71 +305,1497 @@ void Circuit::add_c_source(std::string name, std::string node_name, double value
   }
 }
 
+bool Circuit::add_c_source(std::string name, Node *pos, Node *neg, double value)
+{
+  CurrentSource *c_source = new CurrentSource(std::move(name), value, _current_source_id);
+  if (!_element_names.emplace(c_source->name(), c_source).second)
+  {
+    std::cerr << "Error: Element " << c_source->name() << " already exists\n";
+    delete c_source;
+    return false;
+  }
+  invalidate_plan();
+  _current_source_id++;
+  c_source->set_pos_node(pos);
+  c_source->set_neg_node(neg);
+  c_source->set_index(_elements.size());
+  _elements.push_back(c_source);
+  _current_sources.push_back(c_source);
+  return true;
+}
+
+void Circuit::add_voltage_controlled(std::string name, Dependence dependence, std::string pos_name, std::string neg_name,
+                                     std::string control_pos_name, std::string control_neg_name, double gain)
+{
+  if (dependence != Dependence::VCVS && dependence != Dependence::VCCS)
+  {
+    std::cerr << "Error: Dependent source " << name << " is not voltage controlled\n";
+    return;
+  }
+  Node *pos = get_node(pos_name);
+  Node *neg = get_node(neg_name);
+  Node *control_pos = get_node(control_pos_name);
+  Node *control_neg = get_node(control_neg_name);
+  // Nodes should be already present
+  if (pos == nullptr || neg == nullptr || control_pos == nullptr || control_neg == nullptr)
+  {
+    std::cerr << "Node not found\n";
+    return;
+  }
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return;
+  }
+
+  //Only the voltage output needs a branch current unknown
+  DependentSource *source = new DependentSource(name, dependence, gain, dependence == Dependence::VCVS ? int(_volt_source_id++) : -1);
+  source->set_pos_node(pos);
+  source->set_neg_node(neg);
+  source->set_control_nodes(control_pos, control_neg);
+  add_dependent_source(source);
+}
+
+void Circuit::add_current_controlled(std::string name, Dependence dependence, std::string pos_name, std::string neg_name,
+                                     std::string control_name, double gain)
+{
+  if (dependence != Dependence::CCVS && dependence != Dependence::CCCS)
+  {
+    std::cerr << "Error: Dependent source " << name << " is not current controlled\n";
+    return;
+  }
+  Node *pos = get_node(pos_name);
+  Node *neg = get_node(neg_name);
+  // Nodes should be already present
+  if (pos == nullptr || neg == nullptr)
+  {
+    std::cerr << "Node not found\n";
+    return;
+  }
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return;
+  }
+
+  DependentSource *source = new DependentSource(name, dependence, gain, dependence == Dependence::CCVS ? int(_volt_source_id++) : -1);
+  source->set_pos_node(pos);
+  source->set_neg_node(neg);
+  source->set_control_name(std::move(control_name));
+  add_dependent_source(source);
+}
+
+void Circuit::add_opamp(std::string name, std::string pos_name, std::string neg_name, std::string out_name, std::string ref_name)
+{
+  invalidate_plan();
+
+  Node *pos = get_node(pos_name);
+  Node *neg = get_node(neg_name);
+  Node *out = get_node(out_name);
+  Node *ref = ref_name.empty() ? nullptr : get_node(ref_name);
+  // Nodes should be already present
+  if (pos == nullptr || neg == nullptr || out == nullptr || (!ref_name.empty() && ref == nullptr))
+  {
+    std::cerr << "Node not found\n";
+    return;
+  }
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return;
+  }
+
+  OpAmp *opamp = new OpAmp(name);
+  opamp->set_pos_node(pos);
+  opamp->set_neg_node(neg);
+  opamp->set_output(out);
+  opamp->set_reference(ref);
+  opamp->set_index(_elements.size());
+  _elements.push_back(opamp);
+  _element_names.emplace(name, opamp);
+  _opamps.push_back(opamp);
+  join_components(opamp);
+}
+
+void Circuit::add_capacitor(std::string name, std::string pos_name, std::string neg_name, double capacitance)
+{
+  Node *pos = get_node(pos_name);
+  Node *neg = get_node(neg_name);
+  // Nodes should be already present
+  if (pos == nullptr || neg == nullptr)
+  {
+    std::cerr << "Node not found\n";
+    return;
+  }
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return;
+  }
+
+  Capacitor *capacitor = new Capacitor(name, capacitance);
+  capacitor->set_pos_node(pos);
+  capacitor->set_neg_node(neg);
+  add_two_terminal(capacitor);
+}
+
+void Circuit::add_inductor(std::string name, std::string pos_name, std::string neg_name, double inductance)
+{
+  Node *pos = get_node(pos_name);
+  Node *neg = get_node(neg_name);
+  // Nodes should be already present
+  if (pos == nullptr || neg == nullptr)
+  {
+    std::cerr << "Node not found\n";
+    return;
+  }
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return;
+  }
+
+  Inductor *inductor = new Inductor(name, inductance, _volt_source_id++);
+  inductor->set_pos_node(pos);
+  inductor->set_neg_node(neg);
+  _inductors.push_back(inductor);
+  add_two_terminal(inductor);
+}
+
+void Circuit::add_switch(std::string name, std::string pos_name, std::string neg_name, bool closed)
+{
+  Node *pos = get_node(pos_name);
+  Node *neg = get_node(neg_name);
+  // Nodes should be already present
+  if (pos == nullptr || neg == nullptr)
+  {
+    std::cerr << "Node not found\n";
+    return;
+  }
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return;
+  }
+
+  Switch *element = new Switch(name, closed, _volt_source_id++);
+  element->set_pos_node(pos);
+  element->set_neg_node(neg);
+  _switches.push_back(element);
+  add_two_terminal(element);
+}
+
+void Circuit::add_fuse(std::string name, std::string pos_name, std::string neg_name, double rating)
+{
+  Node *pos = get_node(pos_name);
+  Node *neg = get_node(neg_name);
+  // Nodes should be already present
+  if (pos == nullptr || neg == nullptr)
+  {
+    std::cerr << "Node not found\n";
+    return;
+  }
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return;
+  }
+  //A fuse rated at zero or below would blow on any current, or even with none
+  if (!(rating > 0.0))
+  {
+    std::cerr << "Error: Fuse " << name << " rating must be positive\n";
+    return;
+  }
+
+  Fuse *fuse = new Fuse(name, rating, _volt_source_id++);
+  fuse->set_pos_node(pos);
+  fuse->set_neg_node(neg);
+  _switches.push_back(fuse);
+  add_two_terminal(fuse);
+}
+
+void Circuit::add_two_terminal(Element *element)
+{
+  invalidate_plan();
+  element->set_index(_elements.size());
+  _elements.push_back(element);
+  _element_names.emplace(element->name(), element);
+  join_components(element);
+}
+
+void Circuit::add_dependent_source(DependentSource *source)
+{
+  invalidate_plan();
+  source->set_index(_elements.size());
+  _elements.push_back(source);
+  _element_names.emplace(source->name(), source);
+  _dependent_sources.push_back(source);
+  join_components(source);
+}
+
+bool Circuit::add_element(const std::string &type, const std::string &name, const std::string &pos_name, const std::string &neg_name,
+                          double value)
+{
+  if (get_element(name) != nullptr)
+  {
+    std::cerr << "Error: Element " << name << " already exists\n";
+    return false;
+  }
+  if (get_node(pos_name) == nullptr || get_node(neg_name) == nullptr)
+  {
+    std::cerr << "Node " << (get_node(pos_name) == nullptr ? pos_name : neg_name) << " not found\n";
+    return false;
+  }
+
+  //Both terminals in one call: the per-node adds tell the terminals apart by the sign of the value, which loses the neg
+  //node of a zero source and swaps those of a negative one
+  if (type == "VOLTAGE_SUPPLY")
+  {
+    add_v_source(name, get_node(pos_name), get_node(neg_name), value);
+  }
+  else if (type == "RESISTOR")
+  {
+    add_resistor(name, get_node(pos_name), get_node(neg_name), value);
+  }
+  else if (type == "CURRENT_SUPPLY")
+  {
+    add_c_source(name, get_node(pos_name), get_node(neg_name), value);
+  }
+  else if (type == "CAPACITOR")
+  {
+    add_capacitor(name, pos_name, neg_name, value);
+  }
+  else if (type == "INDUCTOR")
+  {
+    add_inductor(name, pos_name, neg_name, value);
+  }
+  else if (type == "SWITCH")
+  {
+    add_switch(name, pos_name, neg_name, value != 0.0);
+  }
+  else if (type == "FUSE")
+  {
+    add_fuse(name, pos_name, neg_name, value);
+  }
+  else
+  {
+    std::cerr << "Error: Unknown element type " << type << "\n";
+    return false;
+  }
+  //A half-connected element would stamp nothing and break the ground selection, so a failed add leaves no trace
+  Element *element = get_element(name);
+  if (element != nullptr && (element->get_pos_node() == nullptr || element->get_neg_node() == nullptr))
+  {
+    remove_element(name);
+    return false;
+  }
+  return element != nullptr;
+}
+
+std::string Circuit::half_connected() const
+{
+  for (auto element : _elements)
+    if (element->get_pos_node() == nullptr || element->get_neg_node() == nullptr)
+      return element->name();
+  return "";
+}
+
+bool Circuit::remove_element(const std::string &name)
+{
+  Element *element = get_element(name);
+  if (element == nullptr)
+  {
+    std::cerr << "Element " << name << " not found\n";
+    return false;
+  }
+  invalidate_plan();
+  _components_stale = true;
+
+  //Op-amps also hang from their output and reference nodes, voltage controlled sources read their control nodes
+  Node *terminals[4] = {element->get_pos_node(), element->get_neg_node(), nullptr, nullptr};
+  if (element->type() == Type::OPAMP)
+  {
+    OpAmp *opamp = static_cast<OpAmp *>(element);
+    terminals[2] = opamp->output();
+    terminals[3] = opamp->reference();
+    _opamps.erase(std::find(_opamps.begin(), _opamps.end(), opamp));
+  }
+  for (Node *node : terminals)
+    if (node != nullptr)
+      node->remove_element(element);
+  if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE || element->type() == Type::DEPENDENT_CURRENT_SOURCE)
+  {
+    DependentSource *source = static_cast<DependentSource *>(element);
+    if (source->voltage_controlled())
+    {
+      terminals[2] = source->control_pos();
+      terminals[3] = source->control_neg();
+    }
+  }
+
+  auto erase = [element](auto &list)
+  {
+    auto it = std::find(list.begin(), list.end(), element);
+    if (it != list.end())
+      list.erase(it);
+  };
+  erase(_voltage_sources);
+  erase(_current_sources);
+  erase(_dependent_sources);
+  erase(_inductors);
+  erase(_switches);
+  for (auto source : _dependent_sources)
+    if (source->control() == element)
+      source->set_control(nullptr);
+
+  //Branch ids stay dense: the last one moves into the gap
+  int id = branch_id(element);
+  if (id >= 0)
+  {
+    int last = int(--_volt_source_id);
+    for (auto other : _elements)
+      if (other != element && branch_id(other) == last)
+        set_branch_id(other, id);
+  }
+
+  size_t index = element->index();
+  _elements[index] = _elements.back();
+  _elements[index]->set_index(index);
+  _elements.pop_back();
+  _element_names.erase(name);
+  delete element;
+
+  //A node left without elements has an empty KCL row, which makes A singular
+  for (size_t i = 0; i < 4; i++)
+    if (std::find(terminals, terminals + i, terminals[i]) == terminals + i)
+      drop_if_empty(terminals[i]);
+  return true;
+}
+
+void Circuit::drop_if_empty(Node *node)
+{
+  if (node == nullptr || node->num_elements() != 0)
+    return;
+  for (auto source : _dependent_sources)
+    if (source->voltage_controlled() && (source->control_pos() == node || source->control_neg() == node))
+      return;
+
+  //Node ids stay dense: the last node takes the id of the dropped one
+  size_t id = node->id();
+  _nodes[id] = _nodes.back();
+  _nodes[id]->set_id(id);
+  _nodes.pop_back();
+  _node_id--;
+  auto it = _node_names.find(node->name());
+  if (it != _node_names.end() && it->second == node)
+    _node_names.erase(it);
+  if (_ground == node)
+    _ground = nullptr;
+  if (_pinned_ground == node)
+    _pinned_ground = nullptr;
+  _components_stale = true;
+  delete node;
+}
+
+bool Circuit::reconnect(const std::string &name, Terminal terminal, const std::string &node_name)
+{
+  Element *element = get_element(name);
+  Node *node = get_node(node_name);
+  if (element == nullptr || node == nullptr)
+  {
+    std::cerr << (element == nullptr ? "Element " + name : "Node " + node_name) << " not found\n";
+    return false;
+  }
+  Node *old = terminal == Terminal::POS ? element->get_pos_node() : element->get_neg_node();
+  if (old == node)
+    return true;
+
+  invalidate_plan();
+  _components_stale = true;
+  if (old != nullptr)
+    old->remove_element(element);
+  if (terminal == Terminal::POS)
+    element->set_pos_node(node);
+  else
+    element->set_neg_node(node);
+  drop_if_empty(old);
+  return true;
+}
+
+size_t Circuit::component_of(const std::string &name)
+{
+  Node *node = get_node(name);
+  if (node == nullptr)
+    return no_unknown;
+  if (_components_stale)
+    build_components();
+  if (_switches.empty())
+    return find_root(_components, node->id());
+  std::vector<size_t> parent = _components;
+  join_switches(parent);
+  return find_root(parent, node->id());
+}
+
+std::vector<std::string> Circuit::floating_nodes()
+{
+  std::vector<std::string> floating;
+  if (_nodes.empty())
+    return floating;
+  set_ground();
+  if (_components_stale)
+    build_components();
+  std::vector<size_t> parent = _components;
+  join_switches(parent);
+
+  //The output of an op-amp without a reference node returns its current through the ground
+  std::vector<char> grounded(_nodes.size(), 0);
+  grounded[find_root(parent, _ground->id())] = 1;
+  for (auto opamp : _opamps)
+    if (opamp->reference() == nullptr && opamp->output() != nullptr)
+      grounded[find_root(parent, opamp->output()->id())] = 1;
+  for (auto node : _nodes)
+    if (!grounded[find_root(parent, node->id())])
+      floating.push_back(node->name());
+  return floating;
+}
+
+void Circuit::join_switches(std::vector<size_t> &parent) const
+{
+  //Switch states change without the circuit knowing, so they are never part of _components
+  for (auto element : _switches)
+    if (element->closed() && element->get_pos_node() != nullptr && element->get_neg_node() != nullptr)
+      parent[find_root(parent, element->get_pos_node()->id())] = find_root(parent, element->get_neg_node()->id());
+}
+
+void Circuit::join_components(const Element *element)
+{
+  if (_components_stale)
+    return;
+  auto join = [this](const Node *a, const Node *b)
+  {
+    if (a != nullptr && b != nullptr)
+      _components[find_root(_components, a->id())] = find_root(_components, b->id());
+  };
+  switch (element->type())
+  {
+    case Type::RESISTOR:
+    case Type::VOLTAGE_SUPPLY:
+    case Type::INDUCTOR:
+    case Type::DEPENDENT_VOLTAGE_SOURCE: join(element->get_pos_node(), element->get_neg_node()); break;
+    case Type::OPAMP:
+    {
+      //The inputs are held at one voltage, the output is driven against its reference
+      const OpAmp *opamp = static_cast<const OpAmp *>(element);
+      join(opamp->get_pos_node(), opamp->get_neg_node());
+      join(opamp->output(), opamp->reference());
+      break;
+    }
+    default: break;
+  }
+}
+
+void Circuit::build_components()
+{
+  _components.resize(_nodes.size());
+  for (size_t i = 0; i < _components.size(); i++) _components[i] = i;
+  _components_stale = false;
+  for (auto element : _elements) join_components(element);
+}
+
 Node *Circuit::set_ground()
 {
+  //An edit can move the ground, the node that held it is an ordinary node again
+  if (_ground != nullptr)
+    _ground->set_ground(false);
+  if (_pinned_ground != nullptr)
+  {
+    _ground = _pinned_ground;
+    _ground->set_ground();
+    _ground->set_voltage(0);
+    number_unknowns();
+    return _ground;
+  }
   if (_voltage_sources.empty())
   {
     _ground = _nodes.back();
     _ground->set_ground();
     _ground->set_voltage(0);
+    number_unknowns();
     return _ground;
   }
   VoltageSource *v_source = static_cast<VoltageSource *>(_voltage_sources.back());
   v_source->get_neg_node()->set_ground();
   v_source->get_neg_node()->set_voltage(0);
   _ground = v_source->get_neg_node();
+  number_unknowns();
   return _ground;
 }
 
-void Circuit::solve()
+void Circuit::set_ground(Node *node)
+{
+  //The ground numbers the unknowns, a compiled plan for another one is stale
+  if (node != _pinned_ground)
+    invalidate_plan();
+  _pinned_ground = node;
+}
+
+void Circuit::unknown_labels(std::vector<size_t> &rows, std::vector<size_t> &columns) const
+{
+  //A node unknown or KCL row is labelled by the first node it holds, a branch by its element, which keeps its label
+  //when remove_element() renumbers the branches; addresses stay below the top bit that sets them apart from node ids
+  const size_t size = _num_node_unknowns + _volt_source_id;
+  rows.assign(size, no_unknown);
+  columns.assign(size, no_unknown);
+  for (auto node : _nodes)
+  {
+    if (index_of(node) != no_unknown && columns[index_of(node)] == no_unknown)
+      columns[index_of(node)] = node->id();
+    if (row_of(node) != no_unknown && rows[row_of(node)] == no_unknown)
+      rows[row_of(node)] = node->id();
+  }
+  for (auto element : _elements)
+    if (branch_id(element) >= 0)
+      rows[branch_row(element)] = columns[branch_row(element)] = (size_t(1) << 63) | reinterpret_cast<uintptr_t>(element);
+}
+
+//Number the groups of nodes in order of their first node, the group holding the ground gets no unknown
+static size_t number_groups(std::vector<size_t> &parent, size_t ground, std::vector<size_t> &numbers)
+{
+  size_t ground_root = find_root(parent, ground);
+  std::vector<size_t> group(parent.size(), Circuit::no_unknown);
+  size_t count = 0;
+  numbers.resize(parent.size());
+  for (size_t i = 0; i < parent.size(); i++)
+  {
+    size_t root = find_root(parent, i);
+    if (root != ground_root && group[root] == Circuit::no_unknown)
+      group[root] = count++;
+    numbers[i] = root == ground_root ? Circuit::no_unknown : group[root];
+  }
+  return count;
+}
+
+void Circuit::number_unknowns()
+{
+  //Nullators merge the voltage unknowns of the op-amp inputs, norators merge the KCL rows of output and reference
+  std::vector<size_t> columns(_nodes.size());
+  std::vector<size_t> rows(_nodes.size());
+  for (size_t i = 0; i < _nodes.size(); i++) columns[i] = rows[i] = i;
+  for (auto opamp : _opamps)
+  {
+    if (opamp->get_pos_node() == nullptr || opamp->get_neg_node() == nullptr || opamp->output() == nullptr)
+      continue;
+    Node *reference = opamp->reference() ? opamp->reference() : _ground;
+    columns[find_root(columns, opamp->get_pos_node()->id())] = find_root(columns, opamp->get_neg_node()->id());
+    rows[find_root(rows, opamp->output()->id())] = find_root(rows, reference->id());
+  }
+
+  //Without op-amps both numberings are the node ids with the ground left out. A degenerate nullor circuit can merge
+  //more rows than columns or the reverse; the unmatched unknowns or equations stay empty and the solve fails as singular
+  size_t num_columns = number_groups(columns, _ground->id(), _columns);
+  size_t num_rows = number_groups(rows, _ground->id(), _rows);
+  _num_node_unknowns = std::max(num_columns, num_rows);
+}
+
+bool Circuit::solve()
+{
+  _blown.clear();
+  //Every round that blows a fuse opens at least one more, so this ends
+  while (solve_once())
+    if (!blow_fuses())
+      return true;
+  return false;
+}
+
+bool Circuit::blow_fuses()
+{
+  bool blew = false;
+  for (auto element : _switches)
+  {
+    if (element->type() != Type::FUSE)
+      continue;
+    Fuse *fuse = static_cast<Fuse *>(element);
+    if (!fuse->blown() && std::abs(fuse->get_current()) > fuse->rating())
+    {
+      fuse->set_closed(false);
+      _blown.push_back(fuse->name());
+      blew = true;
+    }
+  }
+  return blew;
+}
+
+FactorizationCache::Key Circuit::switch_key() const
+{
+  FactorizationCache::Key key((_switches.size() + 63) / 64, 0);
+  for (size_t i = 0; i < _switches.size(); i++)
+    if (_switches[i]->closed())
+      key[i / 64] |= uint64_t(1) << (i % 64);
+  return key;
+}
+
+bool Circuit::solve_once()
+{
+  std::string description;
+  std::vector<Node *> nodes;
+  std::vector<VoltageSource *> sources;
+  std::vector<DependentSource *> dependents;
+  std::vector<Inductor *> inductors;
+  std::vector<Switch *> switches;
+  _from_cache = false;
+  if (_cache != nullptr)
+  {
+    std::vector<double> values;
+    description = canonical_description();
+    sorted_unknowns(nodes, sources, dependents, inductors, switches);
+    const size_t branches = sources.size() + dependents.size();
+    if (_cache->load(description, nodes.size() + branches + inductors.size() + switches.size(), values))
+    {
+      PhaseTimer timer(profiling(), Phase::WRITE_BACK);
+      for (size_t i = 0; i < nodes.size(); i++) nodes[i]->set_voltage(values[i]);
+      for (size_t i = 0; i < sources.size(); i++) sources[i]->set_current(values[nodes.size() + i]);
+      for (size_t i = 0; i < dependents.size(); i++) dependents[i]->set_current(values[nodes.size() + sources.size() + i]);
+      for (size_t i = 0; i < inductors.size(); i++) inductors[i]->set_current(values[nodes.size() + branches + i]);
+      for (size_t i = 0; i < switches.size(); i++) switches[i]->set_current(values[nodes.size() + branches + inductors.size() + i]);
+      resolve_controls();
+      _from_cache = true;
+      return true;
+    }
+  }
+
+  if (!(_compiled ? solve_compiled() : solve_assembled()))
+    return false;
+
+  if (_cache != nullptr)
+  {
+    std::vector<double> values;
+    values.reserve(nodes.size() + sources.size() + dependents.size() + inductors.size() + switches.size());
+    for (auto node : nodes) values.push_back(node->voltage());
+    for (auto source : sources) values.push_back(source->get_current());
+    for (auto source : dependents) values.push_back(source->get_current());
+    for (auto inductor : inductors) values.push_back(inductor->get_current());
+    for (auto element : switches) values.push_back(element->get_current());
+    _cache->store(description, values);
+  }
+  return true;
+}
+
+bool Circuit::solve_assembled()
 {
-  size_t num_nodes = _nodes.size() - 1;  //Removing ground node
-  size_t num_voltage_sources = _voltage_sources.size();
-  Eigen::MatrixXd A;
+  Eigen::SparseMatrix<double> A;
   Eigen::VectorXd X;
   Eigen::VectorXd Z;
 
+  {
+    PhaseTimer timer(profiling(), Phase::GROUND_SELECTION);
+    set_ground();
+  }
+
+  StampList stamps;
+  {
+    PhaseTimer timer(profiling(), Phase::ASSEMBLY);
+    stamps = build_stamps();
+  }
+
+  //Tiny systems never build A, they are stamped straight into a fixed size matrix. The stamps above are still listed
+  //on the heap, only a compiled circuit solves without allocating
+  if (use_fixed_size(stamps.size))
+  {
+    std::vector<double> values;
+    values.reserve(_elements.size());
+    for (auto element : _elements) values.push_back(element->value());
+    _fixed_size = solve_fixed_size(stamps, values.data());
+    if (_fixed_size)
+      return true;
+  }
+
+  {
+    PhaseTimer timer(profiling(), Phase::ASSEMBLY);
+    fill_matrix_A(A, stamps);
+    //We don't need to fill X as we are solving for it
+    X = Eigen::VectorXd::Zero(stamps.size);
+    fill_vector_Z(Z, stamps);
+  }
+
+  if (_verbose)
+    dump_system(A, Z);
+
+  _update.clear();
+  _switch_cache.clear();
+  _solver_stale = true;
+  if (!solve_for_x(A, X, Z))
+  {
+    std::cerr << "Solution not found\n";
+    return false;
+  }
+  if (_verbose)
+    std::cout << "Solution found\n";
+  return true;
+}
+
+void Circuit::set_backend(Backend backend)
+{
+  _solver.set_backend(backend);
+  _update.clear();
+  _switch_cache.clear();
+  _solver_stale = true;
+  if (_plan != nullptr)
+    _plan->factorized = false;
+}
+
+void Circuit::set_mixed_precision(bool enable)
+{
+  _solver.set_mixed_precision(enable);
+  _update.clear();
+  _switch_cache.clear();
+  _solver_stale = true;
+  if (_plan != nullptr)
+    _plan->factorized = false;
+}
+
+void Circuit::compile()
+{
+  _compiled = true;
+  invalidate_plan();
   set_ground();
 
-  fill_matrix_A(A, num_nodes, num_voltage_sources);
+  auto plan = std::make_unique<CompiledPlan>();
+  plan->stamps = build_stamps();
+  fill_matrix_A(plan->A, plan->stamps);
+  plan->A.makeCompressed();
+  fill_vector_Z(plan->Z, plan->stamps);
 
-  std::cout << "\n MATRIX A: \n";
+  //Entries of a compressed column are sorted by row, so each stamp's slot is found once by binary search
+  const int *outer = plan->A.outerIndexPtr();
+  const int *inner = plan->A.innerIndexPtr();
+  plan->offsets.reserve(plan->stamps.matrix.size());
+  for (auto &stamp : plan->stamps.matrix)
+    plan->offsets.push_back(std::lower_bound(inner + outer[stamp.col], inner + outer[stamp.col + 1], int(stamp.row)) - inner);
 
-  for (int i = 0; i < A.rows(); i++)
+  //Stamps are emitted element by element, so each element owns a contiguous range
+  plan->matrix_begin.assign(_elements.size() + 1, 0);
+  plan->source_begin.assign(_elements.size() + 1, 0);
+  for (auto &stamp : plan->stamps.matrix) plan->matrix_begin[stamp.element + 1]++;
+  for (auto &stamp : plan->stamps.sources) plan->source_begin[stamp.element + 1]++;
+  for (size_t i = 0; i < _elements.size(); i++)
   {
-    for (int j = 0; j < A.cols(); j++) std::cout << A(i, j) << " ";
-    std::cout << std::endl;
+    plan->matrix_begin[i + 1] += plan->matrix_begin[i];
+    plan->source_begin[i + 1] += plan->source_begin[i];
   }
 
-  //We don't need to fill X as we are solving for it
-  X = Eigen::VectorXd::Zero(num_nodes + num_voltage_sources);
-  fill_vector_Z(Z, num_nodes, num_voltage_sources);
+  //The stamps of each slot of A and row of Z, so that a restamp sums a changed slot afresh
+  auto group = [](size_t count, size_t size, auto key, std::vector<size_t> &begin, std::vector<size_t> &grouped)
+  {
+    begin.assign(size + 1, 0);
+    for (size_t t = 0; t < count; t++) begin[key(t) + 1]++;
+    for (size_t i = 0; i < size; i++) begin[i + 1] += begin[i];
+    grouped.resize(count);
+    std::vector<size_t> next(begin.begin(), begin.end() - 1);
+    for (size_t t = 0; t < count; t++) grouped[next[key(t)]++] = t;
+  };
+  group(plan->stamps.matrix.size(), size_t(plan->A.nonZeros()), [&](size_t t) { return plan->offsets[t]; }, plan->slot_begin,
+        plan->slot_stamps);
+  group(plan->stamps.sources.size(), plan->stamps.size, [&](size_t t) { return plan->stamps.sources[t].row; }, plan->row_begin,
+        plan->row_stamps);
 
-  std::cout << "\n VECTOR Z: \n";
+  plan->stamped.reserve(_elements.size());
+  for (auto element : _elements)
+  {
+    plan->stamped.push_back(element->value());
+    element->watch(&plan->dirty);
+  }
+  _plan = std::move(plan);
+}
+
+bool Circuit::use_fixed_size(size_t size) const
+{
+  Backend requested = _solver.requested();
+  return size <= fixed_size_limit && !_verbose && (requested == Backend::AUTO || requested == Backend::FIXED_SIZE);
+}
 
-  for (int i = 0; i < Z.size(); i++) std::cout << Z(i) << " ";
+bool Circuit::solve_fixed_size(const StampList &stamps, const double *values)
+{
+  double X[fixed_size_limit];
+  {
+    PhaseTimer timer(profiling(), Phase::SOLVE);
+    if (!fixed_size_solve(stamps, values, X))
+      return false;
+  }
+  write_back(X);
+  return true;
+}
 
-  if (solve_for_x(A, X, Z))
+void Circuit::invalidate_plan()
+{
+  _switch_cache.clear();
+  _solver_stale = true;
+  if (_plan == nullptr)
+    return;
+  for (auto element : _elements) element->watch(nullptr);
+  _plan.reset();
+}
+
+bool Circuit::solve_compiled()
+{
+  if (_plan == nullptr)
+  {
+    PhaseTimer timer(profiling(), Phase::GROUND_SELECTION);
+    compile();
+  }
+  CompiledPlan &plan = *_plan;
+
+  {
+    //Rewrite the slots each changed element owns, summed afresh from their stamps so that long edit sequences don't
+    //accumulate rounding the way adding differences would
+    PhaseTimer timer(profiling(), Phase::ASSEMBLY);
+    for (Element *element : plan.dirty) plan.stamped[element->index()] = element->value();
+    double *values = plan.A.valuePtr();
+    for (Element *element : plan.dirty)
+    {
+      size_t index = element->index();
+      bool is_switch = element->type() == Type::SWITCH || element->type() == Type::FUSE;
+      for (size_t t = plan.matrix_begin[index]; t < plan.matrix_begin[index + 1]; t++)
+      {
+        if (plan.stamps.matrix[t].kind == StampKind::CONSTANT)
+          continue;
+        size_t slot = plan.offsets[t];
+        values[slot] = 0.0;
+        for (size_t k = plan.slot_begin[slot]; k < plan.slot_begin[slot + 1]; k++)
+        {
+          const MatrixStamp &stamp = plan.stamps.matrix[plan.slot_stamps[k]];
+          values[slot] += stamp_coefficient(stamp.kind, stamp.sign, plan.stamped[stamp.element]);
+        }
+        plan.matrix_changed = true;
+        //Factorizations are kept per switch configuration, for the other values of A as they were. The key of _solver
+        //stays, so that the low-rank update still measures how many switches moved since
+        if (!is_switch)
+        {
+          _switch_cache.clear();
+          _solver_stale = true;
+        }
+      }
+      for (size_t t = plan.source_begin[index]; t < plan.source_begin[index + 1]; t++)
+      {
+        size_t row = plan.stamps.sources[t].row;
+        plan.Z(row) = 0.0;
+        for (size_t k = plan.row_begin[row]; k < plan.row_begin[row + 1]; k++)
+        {
+          const SourceStamp &stamp = plan.stamps.sources[plan.row_stamps[k]];
+          plan.Z(row) += stamp.sign * plan.stamped[stamp.element];
+        }
+      }
+      element->clear_dirty();
+    }
+    plan.dirty.clear();
+  }
+
+  //After the restamp plan.stamped holds the current value of every element
+  _fixed_size = use_fixed_size(plan.stamps.size) && solve_fixed_size(plan.stamps, plan.stamped.data());
+  if (_fixed_size)
+    return true;
+
+  if (_verbose)
+    dump_system(plan.A, plan.Z);
+
+  Eigen::VectorXd X;
+  if (plan.factorized && plan.updated && !plan.matrix_changed)
+  {
+    //Only the right-hand side changed since the last update, which is reused as it is
+    bool solved;
+    {
+      PhaseTimer timer(profiling(), Phase::SOLVE);
+      solved = _update.resolve(_solver, plan.A, plan.Z, X);
+    }
+    if (solved)
+    {
+      write_back(X.data());
+      return true;
+    }
+  }
+
+  //After an update the solver holds the base, which need not share the pattern of A
+  Refactor refactor = !plan.factorized || plan.updated ? Refactor::FULL : plan.matrix_changed ? Refactor::NUMERIC : Refactor::NONE;
+  std::vector<size_t> rows;
+  std::vector<size_t> columns;
+  FactorizationCache::Key key = switch_key();
+  bool swapped = false;
+  if (refactor != Refactor::NONE && !key.empty())
+  {
+    //A switch configuration seen before is still factorized, by _solver or parked in the cache
+    LinearSolver parked;
+    if (key == _solver_key && !_solver_stale)
+    {
+      refactor = Refactor::NONE;
+    }
+    else if (_switch_cache.take(key, parked))
+    {
+      if (!_solver_key.empty() && !_solver_stale)
+        _switch_cache.put(_solver_key, std::move(_solver));
+      _solver = std::move(parked);
+      _solver_key = key;
+      _solver_stale = false;
+      refactor = Refactor::NONE;
+      swapped = true;
+    }
+  }
+  //Switches toggled in bulk are factorized and parked instead, so that the configuration is cached for later
+  bool updatable = key.empty() ||
+                   (!_solver_key.empty() && FactorizationCache::distance(key, _solver_key) <= FactorizationCache::update_limit);
+  if (refactor != Refactor::NONE && updatable && _update.active())
+  {
+    //An edit of a few rows is solved against the factorization of the last refactorized system, which the solver keeps
+    unknown_labels(rows, columns);
+    bool updated;
+    {
+      PhaseTimer timer(profiling(), Phase::SOLVE);
+      updated = _update.solve(_solver, plan.A, plan.Z, rows, columns, X);
+    }
+    if (updated)
+    {
+      plan.factorized = true;
+      plan.updated = true;
+      plan.matrix_changed = false;
+      write_back(X.data());
+      return true;
+    }
+  }
+  if (refactor != Refactor::NONE && !key.empty() && !_solver_key.empty() && !_solver_stale)
+  {
+    //Park the factorization of the previous configuration, copies of a solver carry its settings only
+    LinearSolver fresh(_solver);
+    _switch_cache.put(_solver_key, std::move(_solver));
+    _solver = std::move(fresh);
+    refactor = Refactor::FULL;
+  }
+  if (!solve_for_x(plan.A, X, plan.Z, refactor))
+  {
+    _update.clear();
+    _solver_stale = true;
+    std::cerr << "Solution not found\n";
+    return false;
+  }
+  if (refactor != Refactor::NONE || swapped)
+  {
+    if (rows.empty())
+      unknown_labels(rows, columns);
+    _update.reset(plan.A, rows, columns);
+  }
+  if (refactor != Refactor::NONE)
+  {
+    _solver_key = key;
+    _solver_stale = false;
+  }
+  plan.factorized = true;
+  plan.updated = false;
+  plan.matrix_changed = false;
+  if (_verbose)
     std::cout << "Solution found\n";
+  return true;
+}
+
+LinearSolver Circuit::make_workspace() const
+{
+  LinearSolver workspace(_solver);
+  workspace.seed(_solver);
+  return workspace;
+}
+
+Solution Circuit::evaluate(const std::vector<double> &values) const
+{
+  LinearSolver workspace = make_workspace();
+  return evaluate(values, workspace);
+}
+
+Solution Circuit::evaluate(const std::vector<double> &values, LinearSolver &workspace) const
+{
+  Solution solution;
+  if (_plan == nullptr || values.size() != _elements.size())
+  {
+    std::cerr << "evaluate needs a compiled circuit and one value per element\n";
+    return solution;
+  }
+  const CompiledPlan &plan = *_plan;
+  const size_t n = plan.stamps.size;
+  Eigen::VectorXd X(n);
+
+  Backend requested = _solver.requested();
+  if (n <= fixed_size_limit && (requested == Backend::AUTO || requested == Backend::FIXED_SIZE))
+    solution.found = fixed_size_solve(plan.stamps, values.data(), X.data());
+
+  if (!solution.found)
+  {
+    Eigen::VectorXd Z = Eigen::VectorXd::Zero(n);
+    for (auto &stamp : plan.stamps.sources) Z(stamp.row) += stamp.sign * values[stamp.element];
+
+    //The factorization of the last solve still fits if no value that enters A changed since
+    bool same_matrix = plan.factorized && !plan.updated && !plan.matrix_changed && _solver.concurrent_solve();
+    for (size_t t = 0; same_matrix && t < plan.stamps.matrix.size(); t++)
+    {
+      const MatrixStamp &stamp = plan.stamps.matrix[t];
+      same_matrix = stamp.kind == StampKind::CONSTANT || values[stamp.element] == plan.stamped[stamp.element];
+    }
+    solution.found = same_matrix && _solver.solve(Z, X);
+
+    if (!solution.found)
+    {
+      //Same pattern, values of this call, factorized by the caller's workspace on the symbolic analysis it already has
+      Eigen::SparseMatrix<double> A = plan.A;
+      double *entries = A.valuePtr();
+      std::fill(entries, entries + A.nonZeros(), 0.0);
+      for (size_t t = 0; t < plan.stamps.matrix.size(); t++)
+      {
+        const MatrixStamp &stamp = plan.stamps.matrix[t];
+        entries[plan.offsets[t]] += stamp_coefficient(stamp.kind, stamp.sign, values[stamp.element]);
+      }
+      solution.found = workspace.refactorize(A) && (workspace.solve(Z, X) || (workspace.fall_back() && workspace.solve(Z, X)));
+    }
+  }
+  if (!solution.found)
+    return solution;
+
+  solution.voltages.resize(_nodes.size());
+  for (auto node : _nodes) solution.voltages[node->id()] = index_of(node) == no_unknown ? 0.0 : X(index_of(node));
+
+  //Same sign conventions as the get_current() of each element
+  solution.currents.resize(_elements.size());
+  for (auto element : _elements)
+  {
+    double &current = solution.currents[element->index()];
+    Node *pos = element->get_pos_node();
+    Node *neg = element->get_neg_node();
+    switch (element->type())
+    {
+      case Type::RESISTOR:
+        current = (pos && neg) ? -(solution.voltages[pos->id()] - solution.voltages[neg->id()]) / values[element->index()] : 0.0;
+        break;
+      case Type::VOLTAGE_SUPPLY:
+      case Type::DEPENDENT_VOLTAGE_SOURCE: current = X(branch_row(element)); break;
+      case Type::INDUCTOR:
+      case Type::SWITCH:
+      case Type::FUSE: current = X(branch_row(element)); break;
+      case Type::OPAMP:
+      case Type::CAPACITOR: current = 0.0; break;
+      case Type::DEPENDENT_CURRENT_SOURCE:
+      {
+        DependentSource *source = static_cast<DependentSource *>(element);
+        double control = 0.0;
+        if (source->voltage_controlled())
+          control = solution.voltages[source->control_pos()->id()] - solution.voltages[source->control_neg()->id()];
+        else if (branch_row(source->control()) >= 0)
+          control = X(branch_row(source->control()));
+        current = values[element->index()] * control;
+        break;
+      }
+      default: current = values[element->index()]; break;
+    }
+  }
+  return solution;
+}
+
+Solution Circuit::evaluate() const
+{
+  std::vector<double> values;
+  values.reserve(_elements.size());
+  for (auto element : _elements) values.push_back(element->value());
+  return evaluate(values);
+}
+
+Sensitivity Circuit::sensitivities(const std::vector<std::string> &outputs)
+{
+  Sensitivity result;
+  std::vector<Node *> output_nodes;
+  output_nodes.reserve(outputs.size());
+  for (auto &name : outputs)
+  {
+    Node *node = get_node(name);
+    if (node == nullptr)
+    {
+      std::cerr << "Node " << name << " not found\n";
+      return result;
+    }
+    output_nodes.push_back(node);
+  }
+  if (!solve())
+    return result;
+
+  StampList built;
+  const StampList &stamps = _plan != nullptr ? _plan->stamps : (built = build_stamps());
+  std::vector<double> values;
+  values.reserve(_elements.size());
+  for (auto element : _elements) values.push_back(element->value());
+
+  //Fixed size kernels and cache hits leave no factorization behind, neither may a plan with unapplied changes
+  bool factorized = !_fixed_size && !_from_cache && (_plan == nullptr || (_plan->factorized && !_plan->updated && !_plan->matrix_changed));
+  if (!factorized)
+  {
+    Eigen::SparseMatrix<double> A;
+    fill_matrix_A(A, stamps);
+    if (_plan != nullptr)
+      _plan->factorized = false;
+    _update.clear();
+    _solver_stale = true;
+    if (!_solver.factorize(A))
+    {
+      std::cerr << "Sensitivities not found\n";
+      return result;
+    }
+  }
+
+  //Unknowns of the solution, read back from the nodes and branch currents it was written to
+  Eigen::VectorXd X = Eigen::VectorXd::Zero(stamps.size);
+  for (auto node : _nodes)
+    if (index_of(node) != no_unknown)
+      X(index_of(node)) = node->voltage();
+  for (auto source : _voltage_sources) X(branch_row(source)) = source->get_current();
+  for (auto source : _dependent_sources)
+    if (source->id() >= 0)
+      X(branch_row(source)) = source->get_current();
+  for (auto inductor : _inductors) X(branch_row(inductor)) = inductor->get_current();
+  for (auto element : _switches) X(branch_row(element)) = element->get_current();
+
+  //dV/dp = lambda^T (dZ/dp - dA/dp X) with A^T lambda = e_output, the stamps of p give both derivatives
+  const size_t num_elements = _elements.size();
+  result.outputs = outputs;
+  result.num_elements = num_elements;
+  result.derivatives.assign(outputs.size() * num_elements, 0.0);
+  Eigen::VectorXd e = Eigen::VectorXd::Zero(stamps.size);
+  Eigen::VectorXd lambda;
+  for (size_t k = 0; k < output_nodes.size(); k++)
+  {
+    //The ground and nodes tied to it by an op-amp stay at 0 V whatever the values
+    size_t column = index_of(output_nodes[k]);
+    if (column == no_unknown)
+      continue;
+
+    e.setZero();
+    e(column) = 1.0;
+    if (!_solver.solve_transposed(e, lambda) && !(_solver.fall_back() && _solver.solve_transposed(e, lambda)))
+    {
+      std::cerr << "Sensitivities not found\n";
+      result.derivatives.clear();
+      return result;
+    }
+
+    double *row = result.derivatives.data() + k * num_elements;
+    for (auto &stamp : stamps.sources) row[stamp.element] += lambda(stamp.row) * stamp.sign;
+    for (auto &stamp : stamps.matrix)
+      if (stamp.kind != StampKind::CONSTANT)
+        row[stamp.element] -= lambda(stamp.row) * stamp_derivative(stamp.kind, stamp.sign, values[stamp.element]) * X(stamp.col);
+  }
+  result.found = true;
+  return result;
+}
+
+std::string Circuit::canonical_description()
+{
+  std::vector<Node *> nodes;
+  std::vector<VoltageSource *> sources;
+  std::vector<DependentSource *> dependents;
+  std::vector<Inductor *> inductors;
+  std::vector<Switch *> switches;
+  sorted_unknowns(nodes, sources, dependents, inductors, switches);
+  std::vector<const Element *> elements(_elements.begin(), _elements.end());
+  std::sort(elements.begin(), elements.end(), [](const Element *a, const Element *b) { return a->name() < b->name(); });
+
+  //Hex floats keep every bit of the values, two circuits only share a description if they solve identically
+  std::ostringstream out;
+  out << std::hexfloat << "ground " << set_ground()->name() << "\n";
+  for (auto node : nodes) out << "node " << node->name() << "\n";
+  for (auto element : elements)
+  {
+    out << int(element->type()) << " " << element->name() << " " << (element->get_pos_node() ? element->get_pos_node()->name() : "-")
+        << " " << (element->get_neg_node() ? element->get_neg_node()->name() : "-") << " " << element->value();
+    if (element->type() == Type::OPAMP)
+    {
+      const OpAmp *opamp = static_cast<const OpAmp *>(element);
+      out << " " << opamp->output()->name() << " " << (opamp->reference() ? opamp->reference()->name() : "-");
+    }
+    else if (element->type() == Type::FUSE)
+    {
+      out << " " << static_cast<const Fuse *>(element)->rating();
+    }
+    else if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE || element->type() == Type::DEPENDENT_CURRENT_SOURCE)
+    {
+      const DependentSource *source = static_cast<const DependentSource *>(element);
+      out << " " << int(source->dependence()) << " ";
+      if (source->voltage_controlled())
+        out << source->control_pos()->name() << " " << source->control_neg()->name();
+      else
+        out << source->control_name();
+    }
+    out << "\n";
+  }
+  return out.str();
+}
+
+void Circuit::sorted_unknowns(std::vector<Node *> &nodes, std::vector<VoltageSource *> &sources, std::vector<DependentSource *> &dependents,
+                              std::vector<Inductor *> &inductors, std::vector<Switch *> &switches) const
+{
+  nodes = _nodes;
+  sources = _voltage_sources;
+  inductors = _inductors;
+  std::sort(inductors.begin(), inductors.end(), [](const Inductor *a, const Inductor *b) { return a->name() < b->name(); });
+  switches = _switches;
+  std::sort(switches.begin(), switches.end(), [](const Switch *a, const Switch *b) { return a->name() < b->name(); });
+  dependents.clear();
+  for (auto source : _dependent_sources)
+    if (source->id() >= 0)
+      dependents.push_back(source);
+  std::sort(dependents.begin(), dependents.end(), [](const DependentSource *a, const DependentSource *b) { return a->name() < b->name(); });
+  std::sort(nodes.begin(), nodes.end(), [](const Node *a, const Node *b) { return a->name() < b->name(); });
+  std::sort(sources.begin(), sources.end(), [](const VoltageSource *a, const VoltageSource *b) { return a->name() < b->name(); });
+}
+
+long Circuit::node_unknown(const std::string &name)
+{
+  Node *node = get_node(name);
+  if (node == nullptr || index_of(node) == no_unknown)
+    return -1;
+  return index_of(node);
+}
+
+long Circuit::node_row(const std::string &name)
+{
+  Node *node = get_node(name);
+  if (node == nullptr || row_of(node) == no_unknown)
+    return -1;
+  return row_of(node);
+}
+
+//Contributions to the row or column of a node tied to the ground (the ground itself, or an input of an op-amp whose
+//other input is grounded, or the output of an op-amp referenced to the ground) drop out
+static void add_matrix_stamp(StampList &stamps, size_t row, size_t col, double sign, size_t element, StampKind kind)
+{
+  if (row != Circuit::no_unknown && col != Circuit::no_unknown)
+    stamps.matrix.push_back({row, col, sign, element, kind});
+}
+
+static void add_reactive_stamp(StampList &stamps, size_t row, size_t col, double sign, size_t element)
+{
+  if (row != Circuit::no_unknown && col != Circuit::no_unknown)
+    stamps.reactive.push_back({row, col, sign, element, StampKind::VALUE});
+}
+
+static void add_source_stamp(StampList &stamps, size_t row, double sign, size_t element)
+{
+  if (row != Circuit::no_unknown)
+    stamps.sources.push_back({row, sign, element});
+}
+
+StampList Circuit::build_stamps() const
+{
+  resolve_controls();
+
+  StampList stamps;
+  stamps.num_nodes = _num_node_unknowns;
+  stamps.size = stamps.num_nodes + _volt_source_id;
+  stamps.matrix.reserve(4 * _elements.size());
+
+  for (size_t i = 0; i < _elements.size(); i++)
+  {
+    Element *element = _elements[i];
+    Node *pos = element->get_pos_node();
+    Node *neg = element->get_neg_node();
+    if (pos == nullptr || neg == nullptr)
+      continue;
+
+    if (element->type() == Type::RESISTOR)
+    {
+      //Diagonal elements get the conductance, off-diagonal (pos, neg) pairs get its negative
+      add_matrix_stamp(stamps, row_of(pos), index_of(pos), 1, i, StampKind::CONDUCTANCE);
+      add_matrix_stamp(stamps, row_of(neg), index_of(neg), 1, i, StampKind::CONDUCTANCE);
+      add_matrix_stamp(stamps, row_of(pos), index_of(neg), -1, i, StampKind::CONDUCTANCE);
+      add_matrix_stamp(stamps, row_of(neg), index_of(pos), -1, i, StampKind::CONDUCTANCE);
+    }
+    else if (element->type() == Type::VOLTAGE_SUPPLY)
+    {
+      //B and C blocks hold the incidence of the source, E holds its voltage
+      size_t row = branch_row(element);
+      add_matrix_stamp(stamps, row_of(pos), row, 1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row, index_of(pos), 1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row_of(neg), row, -1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row, index_of(neg), -1, i, StampKind::CONSTANT);
+      add_source_stamp(stamps, row, 1, i);
+    }
+    else if (element->type() == Type::CURRENT_SOURCE)
+    {
+      //Current sources add their value for pos node and subtract it for neg node
+      add_source_stamp(stamps, row_of(pos), 1, i);
+      add_source_stamp(stamps, row_of(neg), -1, i);
+    }
+    else if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE || element->type() == Type::DEPENDENT_CURRENT_SOURCE)
+    {
+      stamp_dependent_source(stamps, static_cast<DependentSource *>(element), i);
+    }
+    else if (element->type() == Type::CAPACITOR)
+    {
+      //Same pattern as a resistor, in C and with the capacitance itself
+      add_reactive_stamp(stamps, row_of(pos), index_of(pos), 1, i);
+      add_reactive_stamp(stamps, row_of(neg), index_of(neg), 1, i);
+      add_reactive_stamp(stamps, row_of(pos), index_of(neg), -1, i);
+      add_reactive_stamp(stamps, row_of(neg), index_of(pos), -1, i);
+    }
+    else if (element->type() == Type::INDUCTOR)
+    {
+      //The incidence of a voltage source of 0 V, and vpos - vneg - s * L * current = 0 in the pencil
+      size_t row = branch_row(element);
+      add_matrix_stamp(stamps, row_of(pos), row, 1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row, index_of(pos), 1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row_of(neg), row, -1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row, index_of(neg), -1, i, StampKind::CONSTANT);
+      add_reactive_stamp(stamps, row, row, -1, i);
+    }
+    else if (element->type() == Type::SWITCH || element->type() == Type::FUSE)
+    {
+      //Closed (value 1): vpos - vneg = 0 like a voltage source of 0 V. Open (value 0): current = 0. Both entries of the
+      //branch row are always stamped, so toggling keeps the pattern and only changes values
+      size_t row = branch_row(element);
+      add_matrix_stamp(stamps, row_of(pos), row, 1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row_of(neg), row, -1, i, StampKind::CONSTANT);
+      add_matrix_stamp(stamps, row, index_of(pos), 1, i, StampKind::VALUE);
+      add_matrix_stamp(stamps, row, index_of(neg), -1, i, StampKind::VALUE);
+      add_matrix_stamp(stamps, row, row, 1, i, StampKind::COMPLEMENT);
+    }
+    //Op-amps stamp nothing, number_unknowns() already merged their rows and columns
+  }
+  return stamps;
+}
+
+void Circuit::resolve_controls() const
+{
+  //The controlling element may have been added after the source, so it is looked up once the circuit is complete
+  for (auto source : _dependent_sources)
+  {
+    if (source->voltage_controlled())
+      continue;
+    auto it = _element_names.find(source->control_name());
+    Element *control = it == _element_names.end() ? nullptr : it->second;
+    if (branch_row(control) < 0)
+    {
+      std::cerr << "Error: Dependent source " << source->name() << " is controlled by " << source->control_name()
+                << ", which is not a voltage source, VCVS or CCVS\n";
+      control = nullptr;
+    }
+    source->set_control(control);
+  }
+}
+
+long Circuit::branch_row(const Element *element) const
+{
+  if (element == nullptr)
+    return -1;
+  if (element->type() == Type::VOLTAGE_SUPPLY)
+    return _num_node_unknowns + static_cast<const VoltageSource *>(element)->id();
+  if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE)
+    return _num_node_unknowns + static_cast<const DependentSource *>(element)->id();
+  if (element->type() == Type::INDUCTOR)
+    return _num_node_unknowns + static_cast<const Inductor *>(element)->id();
+  if (element->type() == Type::SWITCH || element->type() == Type::FUSE)
+    return _num_node_unknowns + static_cast<const Switch *>(element)->id();
+  return -1;
+}
+
+void Circuit::stamp_dependent_source(StampList &stamps, DependentSource *source, size_t index) const
+{
+  struct Term
+  {
+    size_t row;
+    double sign;
+  };
+  Term outputs[2];
+  Term controls[2];
+  Node *pos = source->get_pos_node();
+  Node *neg = source->get_neg_node();
+
+  size_t num_outputs = 0;
+  if (source->type() == Type::DEPENDENT_VOLTAGE_SOURCE)
+  {
+    //Same incidence as a voltage source, but the branch row reads vpos - vneg - gain * control = 0
+    size_t row = branch_row(source);
+    add_matrix_stamp(stamps, row_of(pos), row, 1, index, StampKind::CONSTANT);
+    add_matrix_stamp(stamps, row, index_of(pos), 1, index, StampKind::CONSTANT);
+    add_matrix_stamp(stamps, row_of(neg), row, -1, index, StampKind::CONSTANT);
+    add_matrix_stamp(stamps, row, index_of(neg), -1, index, StampKind::CONSTANT);
+    outputs[num_outputs++] = {row, -1};
+  }
   else
-    std::cerr << "Solution not found\n";
+  {
+    //gain * control leaves pos and enters neg, like the current of a resistor
+    outputs[num_outputs++] = {row_of(pos), 1};
+    outputs[num_outputs++] = {row_of(neg), -1};
+  }
+
+  size_t num_controls = 0;
+  if (source->voltage_controlled())
+  {
+    controls[num_controls++] = {index_of(source->control_pos()), 1};
+    controls[num_controls++] = {index_of(source->control_neg()), -1};
+  }
+  else if (branch_row(source->control()) >= 0)
+  {
+    controls[num_controls++] = {size_t(branch_row(source->control())), 1};
+  }
+
+  for (size_t o = 0; o < num_outputs; o++)
+    for (size_t c = 0; c < num_controls; c++)
+      add_matrix_stamp(stamps, outputs[o].row, controls[c].row, outputs[o].sign * controls[c].sign, index, StampKind::VALUE);
 }
 
-Circuit Circuit::create_from_json(const std::string &file_path)
+Circuit Circuit::create_from_json(const std::string &file_path, bool profile)
 {
   Circuit circuit;
+  circuit.enable_profiling(profile);
+  circuit.load_json(file_path);
+  return circuit;
+}
+
+void Circuit::load_json(const std::string &file_path)
+{
+  PhaseTimer timer(profiling(), Phase::PARSE);
 
-  std::ifstream f(file_path);
+  InputFile f(file_path);
   json Json = json::parse(f);
-  auto nodes = Json["nodes"];
+  const json &nodes = Json["nodes"];
+  const json &elements = Json["elements"];
+  reserve(_nodes.size() + nodes.size(), _elements.size() + elements.size());
 
   for (auto &node : nodes)
   {
     std::string name = node["name"];
-    circuit.add_node(name);
+    add_node(name);
+  }
+
+  //Generated structures before the elements, which may connect to their nodes
+  for (auto &generator : Json.value("generators", json::array()))
+  {
+    std::string type = generator["type"];
+    bool added = false;
+    if (type == "GRID")
+    {
+      double resistance = generator.value("resistance", 1.0);
+      added = NetlistGenerator::grid(*this, generator["name"], generator["rows"], generator["columns"],
+                                     generator.value("horizontal", resistance), generator.value("vertical", resistance));
+    }
+    else if (type == "LADDER")
+    {
+      added = NetlistGenerator::ladder(*this, generator["name"], generator["bits"], generator["resistance"], generator["ground"]);
+    }
+    else if (type == "ARRAY")
+    {
+      std::vector<NetlistGenerator::Template> instance;
+      for (auto &element : generator["elements"])
+        instance.push_back({element["type"], element["name"], element["posNode"], element["negNode"], element["value"],
+                            element.value("step", 0.0)});
+      added = NetlistGenerator::array(*this, generator["count"], instance);
+    }
+    //Elements may connect to any generated node, so a structure that is only half there fails the whole load
+    if (!added)
+    {
+      std::string name = generator.value("name", std::string());
+      throw std::runtime_error("Cannot generate " + type + (name.empty() ? "" : " " + name) + " in " + file_path);
+    }
   }
 
-  auto elements = Json["elements"];
   for (auto &element : elements)
   {
     std::string name = element["name"];
@@ -235,24 +1804,26 @@ Circuit Circuit::create_from_json(const std::string &file_path)
     std::string posNode = element["posNode"];
     std::string negNode = element["negNode"];
 
-    if (type == "VOLTAGE_SUPPLY")
+    if (type == "VOLTAGE_SUPPLY" || type == "RESISTOR" || type == "CURRENT_SUPPLY" || type == "CAPACITOR" || type == "INDUCTOR" ||
+        type == "SWITCH" || type == "FUSE")
     {
-      circuit.add_v_source(name, posNode, value);
-      circuit.add_v_source(name, negNode, -value);
+      add_element(type, name, posNode, negNode, value);
     }
-    else if (type == "RESISTOR")
+    else if (type == "OPAMP")
     {
-      circuit.add_resistor(name, posNode, value);
-      circuit.add_resistor(name, negNode, value);
+      add_opamp(name, posNode, negNode, element.at("outNode").get<std::string>(), element.value("refNode", std::string()));
     }
-    else if (type == "CURRENT_SUPPLY")
+    else if (type == "VCVS" || type == "VCCS")
     {
-      circuit.add_c_source(name, posNode, value);
-      circuit.add_c_source(name, negNode, -value);
+      add_voltage_controlled(name, type == "VCVS" ? Dependence::VCVS : Dependence::VCCS, posNode, negNode,
+                             element.at("controlPosNode").get<std::string>(), element.at("controlNegNode").get<std::string>(), value);
+    }
+    else if (type == "CCVS" || type == "CCCS")
+    {
+      add_current_controlled(name, type == "CCVS" ? Dependence::CCVS : Dependence::CCCS, posNode, negNode,
+                             element.at("control").get<std::string>(), value);
     }
   }
-
-  return circuit;
 }
 
 // TODO: Potential improvements according to Claude:
@@ -2,30 +2,70 @@
 
 #include <cstddef>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "../../Include/Eigen/Dense"
+#include "../../Include/Eigen/SparseCore"
+#include "Cache.hpp"
 #include "Element.hpp"
+#include "Factorization.hpp"
 #include "Node.hpp"
+#include "Profile.hpp"
+#include "Sensitivity.hpp"
+#include "Solution.hpp"
+#include "Solver.hpp"
+#include "Stamp.hpp"
+#include "Update.hpp"
 
 /**
- * @class Element
- * @brief Base class for all electrical elements.
+ * @class Circuit
+ * @brief Owns the nodes and elements of a circuit and solves it. Move-only: the nodes, elements and compiled plan live
+ * on the heap and point at each other, so moving a circuit hands them over without copying or relinking anything.
  */
 class Circuit
 {
-  std::vector<Node *> _nodes;                     //> Vector of all nodes in the circuit
-  std::vector<Element *> _elements;               //> Vector of all elements in the circuit
-  std::vector<VoltageSource *> _voltage_sources;  //> Vector of all voltage sources in the circuit
-  std::vector<CurrentSource *> _current_sources;  //> Vector of all current sources in the circuit
-  size_t _volt_source_id;                         //> Voltage source identifier
-  size_t _current_source_id;                      //> Current source identifier
-  size_t _node_id;                                //> Node identifier
-  Node *_ground;                                  //> Ground node
+  std::vector<Node *> _nodes;                                 //> Vector of all nodes in the circuit, owned
+  std::vector<Element *> _elements;                           //> Vector of all elements in the circuit, owned
+  std::unordered_map<std::string, Node *> _node_names;        //> Nodes by name, the first of duplicate names wins
+  std::unordered_map<std::string, Element *> _element_names;  //> Elements by name
+  std::vector<VoltageSource *> _voltage_sources;              //> Vector of all voltage sources in the circuit
+  std::vector<CurrentSource *> _current_sources;              //> Vector of all current sources in the circuit
+  std::vector<DependentSource *> _dependent_sources;          //> Vector of all dependent sources in the circuit
+  std::vector<OpAmp *> _opamps;                               //> Vector of all ideal op-amps in the circuit
+  std::vector<Inductor *> _inductors;                         //> Vector of all inductors in the circuit
+  std::vector<Switch *> _switches;                            //> Vector of all switches and fuses in the circuit
+  size_t _volt_source_id;                                     //> Branch current identifier of voltage sources, VCVS, CCVS, inductors and switches
+  size_t _current_source_id;                                  //> Current source identifier
+  size_t _node_id;                                            //> Node identifier
+  Node *_ground;                                              //> Ground node
+  Node *_pinned_ground;                                       //> Ground chosen by the caller, nullptr to pick one from the sources
+  std::vector<size_t> _columns;                               //> Voltage unknown of each node by Node::id(), shared by op-amp inputs
+  std::vector<size_t> _rows;                                  //> KCL row of each node by Node::id(), shared by op-amp output and reference
+  size_t _num_node_unknowns;                                  //> Number of node voltage unknowns, branch currents follow them
+  bool _verbose;                                              //> Print the assembled system and solution while solving
+  bool _profiling;                                            //> Record per-phase time and memory into _profile
+  SolveProfile _profile;                                      //> Per-phase measurements, filled when _profiling is set
+  LinearSolver _solver;                                       //> Backend and factorization of the last solve
+  bool _compiled;                                             //> Solve through a compiled plan, rebuilt after structural changes
+  struct CompiledPlan;
+  std::unique_ptr<CompiledPlan> _plan;                        //> Stamp offsets and assembled system, nullptr until compiled
+  bool _fixed_size;                                           //> The last solve ran a fixed size kernel instead of _solver
+  const ResultCache *_cache;                                  //> Consulted before solving and filled after, nullptr when off
+  bool _from_cache;                                           //> The last solve was answered by _cache
+  LowRankUpdate _update;                                      //> Last factorized A of a compiled circuit, edits are solved against it
+  std::vector<size_t> _components;                            //> Union-find parent of each node by Node::id(), through DC paths
+  bool _components_stale;                                     //> _components needs a rebuild after a removal or reconnection
+  FactorizationCache _switch_cache;                           //> Factorizations of the other switch configurations of a compiled circuit
+  FactorizationCache::Key _solver_key;                        //> Switch states _solver last factorized, empty if none
+  bool _solver_stale;                                         //> Other values of A changed since, _solver is neither reused nor parked
+  std::vector<std::string> _blown;                            //> Fuses blown by the last solve, in order
 
 public:
+  static constexpr size_t no_unknown = size_t(-1);  ///< Row or column of a node tied to the ground
+
   /**
      * @brief Constructor for Circuit.
      */
@@ -36,6 +76,27 @@ public:
      */
   ~Circuit();
 
+  Circuit(const Circuit &) = delete;
+  Circuit &operator=(const Circuit &) = delete;
+
+  /**
+     * @brief Move constructor, takes over the nodes, elements, plan and factorization of other and leaves it empty.
+     */
+  Circuit(Circuit &&other) noexcept;
+
+  /**
+     * @brief Move assignment, frees the current contents first.
+     */
+  Circuit &operator=(Circuit &&other) noexcept;
+
+  /**
+     * @brief Reserve room for a number of nodes and elements, avoids regrowing the vectors and name tables while a
+     * large circuit is added.
+     * @param nodes Number of nodes.
+     * @param elements Number of elements.
+     */
+  void reserve(size_t nodes, size_t elements);
+
   /**
      * @brief Adds a node to the circuit.
      * @param name Name of the node.
@@ -68,6 +129,17 @@ public:
      */
   void add_resistor(std::string name, std::string node_name, double value);
 
+  /*
+     * @brief Add a resistor between two nodes of this circuit in one call, without looking the nodes up by name. For
+     * generated circuits, where the nodes are at hand.
+     * @param name Name of the resistor.
+     * @param pos Positive node.
+     * @param neg Negative node.
+     * @param value Resistance value of the resistor.
+     * @return False if an element of that name exists.
+     */
+  bool add_resistor(std::string name, Node *pos, Node *neg, double value);
+
   /*
      * @brief Add a voltage source to the circuit.
      * @param name Name of the voltage source.
@@ -76,6 +148,17 @@ public:
      */
   void add_v_source(std::string name, std::string node_name, double value);
 
+  /*
+     * @brief Add a voltage source between two nodes of this circuit in one call, pos at value above neg. Unlike the
+     * per-node form, any value including zero is accepted.
+     * @param name Name of the voltage source.
+     * @param pos Positive node.
+     * @param neg Negative node.
+     * @param value Voltage value of the voltage source.
+     * @return False if an element of that name exists.
+     */
+  bool add_v_source(std::string name, Node *pos, Node *neg, double value);
+
   /*
      * @brief Add a current source to the circuit.
      * @param name Name of the current source.
@@ -84,15 +167,322 @@ public:
      */
   void add_c_source(std::string name, std::string node_name, double value);
 
+  /*
+     * @brief Add a current source between two nodes of this circuit in one call, driving value into pos. Unlike the
+     * per-node form, any value including zero is accepted.
+     * @param name Name of the current source.
+     * @param pos Positive node.
+     * @param neg Negative node.
+     * @param value Current value of the current source.
+     * @return False if an element of that name exists.
+     */
+  bool add_c_source(std::string name, Node *pos, Node *neg, double value);
+
+  /*
+     * @brief Add a voltage controlled source (VCVS or VCCS) to the circuit. All four nodes must exist.
+     * @param name Name of the source.
+     * @param dependence VCVS or VCCS.
+     * @param pos_name Name of the positive node.
+     * @param neg_name Name of the negative node.
+     * @param control_pos_name Name of the positive controlling node.
+     * @param control_neg_name Name of the negative controlling node.
+     * @param gain Voltage gain (VCVS) or transconductance in siemens (VCCS).
+     */
+  void add_voltage_controlled(std::string name, Dependence dependence, std::string pos_name, std::string neg_name,
+                              std::string control_pos_name, std::string control_neg_name, double gain);
+
+  /*
+     * @brief Add a current controlled source (CCVS or CCCS) to the circuit. The controlling element may be added later,
+     * it is looked up when the circuit is stamped.
+     * @param name Name of the source.
+     * @param dependence CCVS or CCCS.
+     * @param pos_name Name of the positive node.
+     * @param neg_name Name of the negative node.
+     * @param control_name Name of the voltage source, VCVS or CCVS whose current controls the source.
+     * @param gain Transresistance in ohms (CCVS) or current gain (CCCS).
+     */
+  void add_current_controlled(std::string name, Dependence dependence, std::string pos_name, std::string neg_name,
+                              std::string control_name, double gain);
+
+  /*
+     * @brief Add an ideal op-amp to the circuit. It removes an unknown instead of adding one: the inputs share a voltage
+     * unknown and the output and reference share a KCL equation. The output current is not computed.
+     * @param name Name of the op-amp.
+     * @param pos_name Name of the non-inverting input node.
+     * @param neg_name Name of the inverting input node.
+     * @param out_name Name of the output node.
+     * @param ref_name Name of the node the output current returns through, empty for the ground of the circuit.
+     */
+  void add_opamp(std::string name, std::string pos_name, std::string neg_name, std::string out_name, std::string ref_name = "");
+
+  /*
+     * @brief Add a capacitor to the circuit, an open circuit for DC solves. Both nodes must exist.
+     * @param name Name of the capacitor.
+     * @param pos_name Name of the positive node.
+     * @param neg_name Name of the negative node.
+     * @param capacitance Capacitance in farads.
+     */
+  void add_capacitor(std::string name, std::string pos_name, std::string neg_name, double capacitance);
+
+  /*
+     * @brief Add an inductor to the circuit, a short with a branch current unknown for DC solves. Both nodes must exist.
+     * @param name Name of the inductor.
+     * @param pos_name Name of the positive node.
+     * @param neg_name Name of the negative node.
+     * @param inductance Inductance in henries.
+     */
+  void add_inductor(std::string name, std::string pos_name, std::string neg_name, double inductance);
+
+  /*
+     * @brief Add an ideal switch to the circuit, a short when closed and an open circuit otherwise. Both nodes must exist.
+     * @param name Name of the switch.
+     * @param pos_name Name of the positive node.
+     * @param neg_name Name of the negative node.
+     * @param closed Initial state.
+     */
+  void add_switch(std::string name, std::string pos_name, std::string neg_name, bool closed);
+
+  /*
+     * @brief Add an ideal fuse to the circuit, a closed switch that solve() opens when its current exceeds the rating.
+     * Both nodes must exist.
+     * @param name Name of the fuse.
+     * @param pos_name Name of the positive node.
+     * @param neg_name Name of the negative node.
+     * @param rating Rating in amperes, positive.
+     */
+  void add_fuse(std::string name, std::string pos_name, std::string neg_name, double rating);
+
+  /*
+     * @brief Add a two-terminal element by the type names of the JSON format: RESISTOR, VOLTAGE_SUPPLY, CURRENT_SUPPLY,
+     * CAPACITOR, INDUCTOR, SWITCH (value 1 closed, 0 open) or FUSE (value is the rating). Both nodes must exist.
+     * @param type Type name.
+     * @param name Name of the element.
+     * @param pos_name Name of the positive node.
+     * @param neg_name Name of the negative node.
+     * @param value Value of the element.
+     * @return True if the element was added with both nodes.
+     */
+  bool add_element(const std::string &type, const std::string &name, const std::string &pos_name, const std::string &neg_name,
+                   double value);
+
+  /*
+     * @brief Find an element with a node missing, which the per-node add functions leave behind when the second node
+     * never comes or does not match. Such an element stamps nothing.
+     * @return Name of the first such element, empty if every element has both nodes.
+     */
+  std::string half_connected() const;
+
+  /*
+     * @brief Remove an element and delete it. The last element takes its index, and the last branch current takes its
+     * branch id if it had one. Dependent sources it controlled stamp nothing until a new control of that name is added.
+     * Nodes left without elements are deleted too, the last node taking the id of each.
+     * @param name Name of the element.
+     * @return False if there is no such element.
+     */
+  bool remove_element(const std::string &name);
+
+  /*
+     * @brief Move one terminal of an element to another node. For an op-amp, the terminals are its inputs. The old node
+     * is deleted if no element is left on it.
+     * @param name Name of the element.
+     * @param terminal Terminal to move.
+     * @param node_name Name of the new node, which must exist.
+     * @return False if the element or node does not exist.
+     */
+  bool reconnect(const std::string &name, Terminal terminal, const std::string &node_name);
+
+  /*
+     * @brief Get the DC component of a node. Nodes of one component are joined by elements that conduct at DC: resistors,
+     * inductors, voltage sources, VCVS and CCVS outputs, op-amps, and closed switches and fuses. Additions join components
+     * as they come, a removal or reconnection rebuilds them on the next query.
+     * @param name Name of the node.
+     * @return Component, equal for all nodes of a component; no_unknown for an unknown name.
+     */
+  size_t component_of(const std::string &name);
+
+  /*
+     * @brief List the nodes without a DC path to the ground, which leave A singular. Sets the ground.
+     */
+  std::vector<std::string> floating_nodes();
+
   //We will set neg_node of last voltage source as ground node and set its voltage to 0 if no voltage_source is present
   //we will set the neg of current source as ground and set voltage to 0
 
   /*
-     * @brief Set ground node
+     * @brief Set ground node, the pinned one if any
      */
   Node *set_ground();
 
-  static Circuit create_from_json(const std::string &file_path);
+  /*
+     * @brief Pin the ground to a node, which every later set_ground() keeps, for netlists that name their ground.
+     * @param node Node of this circuit, nullptr to choose the ground from the voltage sources again.
+     */
+  void set_ground(Node *node);
+
+  /*
+     * @brief Get all nodes of the circuit.
+     */
+  const std::vector<Node *> &nodes() const { return _nodes; }
+
+  /*
+     * @brief Get all elements of the circuit, stamps refer to elements by their index in this vector.
+     */
+  const std::vector<Element *> &elements() const { return _elements; }
+
+  /*
+     * @brief Get the row of a node's voltage in the MNA system. Needs the ground to be set.
+     * @param name Name of the node.
+     * @return Row of the node, -1 for the ground node or an unknown name.
+     */
+  long node_unknown(const std::string &name);
+
+  /*
+     * @brief Get the KCL row of a node in the MNA system, where a current injected into the node enters Z. Needs the
+     * ground to be set.
+     * @param name Name of the node.
+     * @return Row of the node, -1 for the ground, nodes merged with it by an op-amp output or an unknown name.
+     */
+  long node_row(const std::string &name);
+
+  /*
+     * @brief Get the number of node voltage unknowns, the branch current unknowns and their rows follow them.
+     */
+  size_t num_node_unknowns() const { return _num_node_unknowns; }
+
+  /*
+     * @brief List every contribution of every element to A and Z. Needs the ground to be set.
+     */
+  StampList build_stamps() const;
+
+  /*
+     * @brief Compile the circuit for repeated solves with changing values. Records where every element stamps into
+     * the value array of the sparse A, so that value changes through Resistor::set_resistance,
+     * VoltageSource::set_voltage or CurrentSource::set_current are applied by direct indexed writes for the changed
+     * elements only. A change of source values alone skips the factorization, a change of resistances refactorizes
+     * numerically on the same symbolic analysis. Sets the ground; adding nodes or elements recompiles on the next solve.
+     */
+  void compile();
+
+  /*
+     * @brief Check if solves go through a compiled plan.
+     */
+  bool is_compiled() const { return _compiled; }
+
+  /*
+     * @brief Solve without touching the circuit: results go to the returned Solution instead of the nodes and voltage
+     * sources. Needs compile(). Any number of threads may evaluate one circuit at once, provided nothing calls a
+     * non-const method meanwhile. When the values only differ from those of the last solve() in sources, the threads
+     * share that solve's factorization (direct backends only); otherwise each call factorizes its own copy of A.
+     * @param values Value of every element, indexed like elements().
+     * @return Solution, found is false if the circuit is not compiled, values has the wrong size or A is singular.
+     */
+  Solution evaluate(const std::vector<double> &values) const;
+
+  /*
+     * @brief Evaluate with a solver owned by the calling thread. When the shared factorization does not fit, the values
+     * are factorized in the workspace on the symbolic analysis of its previous factorization, so a thread evaluating
+     * many value sets analyzes the pattern once.
+     * @param values Value of every element, indexed like elements().
+     * @param workspace Solver from make_workspace(), only ever used with this circuit and not shared between threads.
+     */
+  Solution evaluate(const std::vector<double> &values, LinearSolver &workspace) const;
+
+  /*
+     * @brief Evaluate with the current values of the elements.
+     */
+  Solution evaluate() const;
+
+  /*
+     * @brief Get a solver with the backend and precision settings of the circuit, for evaluate(). It is seeded with the
+     * fill-reducing ordering of the circuit's last factorization, so workspaces made after a solve share that symbolic
+     * analysis instead of each redoing it.
+     */
+  LinearSolver make_workspace() const;
+
+  /*
+     * @brief Adjoint sensitivity analysis: solve the circuit, then differentiate each output voltage with respect to the
+     * value of every element. The factorization of the solve is reused (a solve answered by a fixed size kernel or the
+     * result cache factorizes once), and each output costs one solve with A^T plus one pass over the stamps, however
+     * many elements there are. Each derivative holds the values of all other elements fixed.
+     * @param outputs Names of the output nodes.
+     * @return Sensitivities, found is false if a node is unknown or the circuit has no solution.
+     */
+  Sensitivity sensitivities(const std::vector<std::string> &outputs);
+
+  /*
+     * @brief Build a circuit from a JSON netlist.
+     * @param file_path Path of the JSON file.
+     * @param profile Enable profiling on the returned circuit, including the parse phase.
+     */
+  static Circuit create_from_json(const std::string &file_path, bool profile = false);
+
+  /*
+     * @brief Add the nodes and elements of a JSON netlist to this circuit. Throws nlohmann::json::exception on a
+     * missing or malformed file, and std::runtime_error if a generator cannot build its structure; the circuit is then
+     * partly loaded and should be dropped.
+     * @param file_path Path of the JSON file.
+     */
+  void load_json(const std::string &file_path);
+
+  /*
+     * @brief Print the matrices and solution vector while solving. Off by default since the dumps are O(n^2).
+     * @param verbose True to print.
+     */
+  void set_verbose(bool verbose) { _verbose = verbose; }
+
+  /*
+     * @brief Choose the linear solver backend. AUTO (the default) picks one from the size, density and symmetry of A,
+     * and solves systems of at most 16 unknowns with FIXED_SIZE.
+     * @param backend Backend to use.
+     */
+  void set_backend(Backend backend);
+
+  /*
+     * @brief Factorize A in single precision and refine the solution in double. Halves the memory of the factors; a
+     * solve whose refinement does not converge is redone with a double precision factorization.
+     * @param enable True to use mixed precision.
+     */
+  void set_mixed_precision(bool enable);
+
+  /*
+     * @brief Get the backend that ran the last solve, AUTO if the circuit was never solved.
+     */
+  Backend backend() const { return _fixed_size ? Backend::FIXED_SIZE : _solver.backend(); }
+
+  /*
+     * @brief Look solutions up in an on-disk cache before solving and store them after. An identical circuit (same
+     * nodes, elements, ground and values, in any order) is answered from the cache without assembling anything.
+     * @param cache Cache to use, nullptr to stop caching. Not owned, it must outlive the circuit or be unset.
+     */
+  void set_cache(const ResultCache *cache) { _cache = cache; }
+
+  /*
+     * @brief Check if the last solve was answered by the result cache, in which case no backend ran.
+     */
+  bool from_cache() const { return _from_cache; }
+
+  /*
+     * @brief Describe the circuit independently of the order nodes and elements were added in: the ground, the node
+     * names sorted, then one line per element sorted by name with its exact value. Sets the ground.
+     * @return Description, the key of the result cache.
+     */
+  std::string canonical_description();
+
+  /*
+     * @brief Start or stop recording per-phase wall time and net heap growth.
+     * @param enable True to record.
+     */
+  void enable_profiling(bool enable = true) { _profiling = enable; }
+
+  /*
+     * @brief Get the measurements recorded so far.
+     */
+  const SolveProfile &profile() const { return _profile; }
+
+  /*
+     * @brief Clear the measurements recorded so far.
+     */
+  void reset_profile() { _profile.reset(); }
 
 
   //Temporary function to check if all nodes and resistors are connected properly
@@ -155,77 +545,208 @@ public:
     */
 
   /*
-     * @brief Solve the circuit
+     * @brief Solve the circuit. Fuses whose current exceeds their rating blow and the circuit is solved again, until no
+     * more fuses blow
+     * @return True if a solution was found and written to the nodes and voltage sources
+     */
+  bool solve();
+
+  /*
+     * @brief Get the fuses blown by the last solve, in the order they blew; fuses over their rating in one solution blow
+     * together.
+     */
+  const std::vector<std::string> &blown_fuses() const { return _blown; }
+
+  /*
+     * @brief Get the cache of factorizations per switch configuration, to size it or read its hit count. Only compiled
+     * circuits use it.
      */
-  void solve();
+  FactorizationCache &factorization_cache() { return _switch_cache; }
 
 private:
   /*
-     * @brief Fill the matrix A
-     * @param A Matrix A
-     * @param num_nodes Number of nodes
-     * @param num_voltage_sources Number of voltage sources
+     * @brief Exchange the contents of two circuits, the nodes and elements keep their addresses
+     */
+  void swap(Circuit &other) noexcept;
+
+  /*
+     * @brief Get the column of a node's voltage in the MNA system. The ground node has none, so nodes after it shift up
+     * by one; the inputs of an op-amp share one column.
+     * @param node Node.
+     * @return Column, no_unknown for the ground and nodes tied to it by an op-amp.
+     */
+  size_t index_of(const Node *node) const { return _columns[node->id()]; }
+
+  /*
+     * @brief Get the KCL row of a node in the MNA system, no_unknown for the ground and nodes merged with it by an
+     * op-amp output.
+     * @param node Node.
      */
-  void fill_matrix_A(Eigen::MatrixXd &A, size_t num_nodes, size_t num_voltage_sources)
+  size_t row_of(const Node *node) const { return _rows[node->id()]; }
+
+  /*
+     * @brief Number the voltage unknowns and KCL rows of the nodes, merging them across op-amps. Called by set_ground
+     */
+  void number_unknowns();
+
+  /*
+     * @brief Label the rows and columns of the MNA system by what they stand for, a node id or a branch id past every
+     * node id, so that LowRankUpdate can match them across edits that renumber the system.
+     * @param rows Set to the label of each row.
+     * @param columns Set to the label of each column.
+     */
+  void unknown_labels(std::vector<size_t> &rows, std::vector<size_t> &columns) const;
+
+  /*
+     * @brief Join the components of the nodes an element connects at DC, unless the components await a rebuild
+     * @param element Element whose nodes are set
+     */
+  void join_components(const Element *element);
+
+  /*
+     * @brief Rebuild the components from every element
+     */
+  void build_components();
+
+  /*
+     * @brief Delete a node that no element connects to or controls from, the last node takes its id
+     * @param node Node, nothing happens for nullptr or a node still in use
+     */
+  void drop_if_empty(Node *node);
+
+  /*
+     * @brief Print the assembled system, only used when verbose
+     */
+  static void dump_system(const Eigen::SparseMatrix<double> &A, const Eigen::VectorXd &Z)
   {
-    A = Eigen::MatrixXd::Zero(num_nodes + num_voltage_sources, num_nodes + num_voltage_sources);
+    std::cout << "\n MATRIX A: \n";
 
-    // Precompute conductances for resistors
-    std::unordered_map<Element *, double> resistor_conductances;
-    for (auto node : _nodes)
+    Eigen::MatrixXd dense(A);
+    for (int i = 0; i < dense.rows(); i++)
     {
-      for (auto node_elem : node->elements())
-        if (node_elem->type() == Type::RESISTOR)
-          resistor_conductances[node_elem] = 1.0 / node_elem->value();
+      for (int j = 0; j < dense.cols(); j++) std::cout << dense(i, j) << " ";
+      std::cout << std::endl;
     }
 
-    for (auto node : _nodes)
-    {
-      //We ignore ground nod
-      if (node->is_ground())
-        continue;
-
-      for (auto node_elem : node->elements())
-      {
-        Node *other_node = node_elem->get_other_node(node);
-        const double conductance = (node_elem->type() == Type::RESISTOR) ? resistor_conductances[node_elem] : 0.0;
-
-        //Handle resistors
-        if (node_elem->type() == Type::RESISTOR)
-        {
-          size_t common_resistors = num_common_resistors(node, other_node);
-          //Diagonal elements
-          //We will consider the prarallel nodes as one node, so if a node has multiple resistors connected to it but they all connected
-          //to the same node, we will calculate cumulative conductance and solve them respectively
-          //We also need to make sure we don't consider the same resistor twice since this is diagonal node and we will go to a nodw twice
-
-          A(node->id(), node->id()) += conductance;
-
-          //Off-diagonal elements
-          if (!other_node->is_ground())
-          {
-            if (common_resistors == 1)
-              A(node->id(), other_node->id()) -= conductance;
-            else
-              A(node->id(), other_node->id()) = -1 / solve_parallel(node, other_node);
-          }
-        }
-        else if (node_elem->type() == Type::VOLTAGE_SUPPLY)  //Handle voltage sources
-        {
-          VoltageSource *v_source = static_cast<VoltageSource *>(node_elem);
-          if (v_source->get_pos_node() == node)
-          {
-            A(node->id(), num_nodes + v_source->id()) = 1;
-            A(num_nodes + v_source->id(), node->id()) = 1;
-          }
-          else
-          {
-            A(node->id(), num_nodes + v_source->id()) = -1;
-            A(num_nodes + v_source->id(), node->id()) = -1;
-          }
-        }
-      }
-    }
+    std::cout << "\n VECTOR Z: \n";
+
+    for (int i = 0; i < Z.size(); i++) std::cout << Z(i) << " ";
+  }
+
+  /*
+     * @brief Check if a system goes to the fixed size kernels. Verbose solves take the general path so that the
+     * assembled system can be printed.
+     * @param size Number of unknowns
+     */
+  bool use_fixed_size(size_t size) const;
+
+  /*
+     * @brief Solve a small system with the kernel instantiated for its size, without building A
+     * @param stamps Contributions of all elements
+     * @param values Value of every element
+     * @return True if solution is found, false if the system is singular and needs the general path
+     */
+  bool solve_fixed_size(const StampList &stamps, const double *values);
+
+  /*
+     * @brief Add a new capacitor, inductor, switch or fuse whose nodes are set
+     * @param element Element, owned by the circuit from now on
+     */
+  void add_two_terminal(Element *element);
+
+  /*
+     * @brief Add a new dependent source whose nodes are set
+     * @param source Source, owned by the circuit from now on
+     */
+  void add_dependent_source(DependentSource *source);
+
+  /*
+     * @brief Get the row of the branch current of a voltage source, VCVS, CCVS or inductor in the MNA system
+     * @param element Element owning a branch current
+     * @return Row of the current, -1 for other elements
+     */
+  long branch_row(const Element *element) const;
+
+  /*
+     * @brief Look up the controlling element of every CCVS and CCCS by name, reporting the ones that have none
+     */
+  void resolve_controls() const;
+
+  /*
+     * @brief List the contributions of a dependent source to A, a CCVS or CCCS without a control stamps nothing
+     * @param stamps List to add to
+     * @param source Dependent source
+     * @param index Index of the source in _elements
+     */
+  void stamp_dependent_source(StampList &stamps, DependentSource *source, size_t index) const;
+
+  /*
+     * @brief Drop the compiled plan after a structural change, the next solve compiles again
+     */
+  void invalidate_plan();
+
+  /*
+     * @brief Solve once with the current switch states, from the result cache if possible
+     * @return True if solution is found
+     */
+  bool solve_once();
+
+  /*
+     * @brief Open the fuses whose current exceeds their rating
+     * @return True if a fuse blew
+     */
+  bool blow_fuses();
+
+  /*
+     * @brief Get the current switch states as a key of _switch_cache
+     * @return One bit per switch, set when closed; empty without switches
+     */
+  FactorizationCache::Key switch_key() const;
+
+  /*
+     * @brief Join the components of the nodes of the closed switches
+     * @param parent Union-find parents of the other elements
+     */
+  void join_switches(std::vector<size_t> &parent) const;
+
+  /*
+     * @brief Solve by assembling A from scratch
+     * @return True if solution is found
+     */
+  bool solve_assembled();
+
+  /*
+     * @brief Nodes and voltage sources sorted by name, the order of the values in the result cache
+     * @param nodes Set to the nodes
+     * @param sources Set to the voltage sources
+     * @param dependents Set to the dependent voltage sources, the other branch currents
+     * @param inductors Set to the inductors, whose branch currents follow
+     * @param switches Set to the switches and fuses, whose branch currents come last
+     */
+  void sorted_unknowns(std::vector<Node *> &nodes, std::vector<VoltageSource *> &sources, std::vector<DependentSource *> &dependents,
+                       std::vector<Inductor *> &inductors, std::vector<Switch *> &switches) const;
+
+  /*
+     * @brief Solve through the compiled plan, restamping only the elements whose value changed
+     * @return True if solution is found
+     */
+  bool solve_compiled();
+
+  /*
+     * @brief Fill the matrix A
+     * @param A Matrix A
+     * @param stamps Contributions of all elements
+     */
+  void fill_matrix_A(Eigen::SparseMatrix<double> &A, const StampList &stamps) const
+  {
+    //Duplicates (parallel resistors, both ends of an element on one node) are summed by setFromTriplets
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(stamps.matrix.size());
+    for (auto &stamp : stamps.matrix)
+      triplets.emplace_back(stamp.row, stamp.col, stamp_coefficient(stamp.kind, stamp.sign, _elements[stamp.element]->value()));
+
+    A.resize(stamps.size, stamps.size);
+    A.setFromTriplets(triplets.begin(), triplets.end());
   }
 
   //Top n elements of Z matrix will have algabraic sum of currents of all nodes except ground node and bottom m elements will have voltage of all voltage sources
@@ -233,88 +754,92 @@ private:
   /*
     * @brief Fill the vector Z
     * @param Z Vector Z
-    * @param num_nodes Number of nodes
-    * @param num_voltage_sources Number of voltage sources
+    * @param stamps Contributions of all elements
     */
-  void fill_vector_Z(Eigen::VectorXd &Z, size_t num_nodes, size_t num_voltage_sources)
+  void fill_vector_Z(Eigen::VectorXd &Z, const StampList &stamps) const
   {
-    Z = Eigen::VectorXd::Zero(num_nodes + num_voltage_sources);
-    for (auto voltage_source : _voltage_sources)
-    {
-      VoltageSource *v_source = static_cast<VoltageSource *>(voltage_source);
-      Z(num_nodes + v_source->id()) = v_source->voltage();
-    }
-    for (auto node : _nodes)
-    {
-      if (!node->is_ground())
-      {
-        double sum = 0;
-        for (auto elem : node->elements())
-        {
-          if (elem->type() == Type::CURRENT_SOURCE)
-          {
-            //if it is current source we will add value for pos node and subtract for neg node
-            CurrentSource *c_source = static_cast<CurrentSource *>(elem);
-            if (c_source->get_pos_node() == node)
-              sum += c_source->value();
-            else
-              sum -= c_source->value();
-          } 
-          Z(node->id()) = sum;
-        }
-      }
-    }
+    Z = Eigen::VectorXd::Zero(stamps.size);
+    for (auto &stamp : stamps.sources) Z(stamp.row) += stamp.sign * _elements[stamp.element]->value();
   }
 
   //We have set of simultaneous equations to solve for X
-  //We will just use Eigen to solve AX = Z and fill resultant X values to nodes and voltage sources
+  //We let the selected backend factorize A and fill resultant X values to nodes and voltage sources
+
+  /*
+    * @brief How much of the factorization solve_for_x has to redo
+    */
+  enum class Refactor
+  {
+    FULL,     //New matrix, analyze and factorize
+    NUMERIC,  //Same pattern as the last factorization, new values
+    NONE,     //Same matrix as the last factorization
+  };
 
   /*
     * @brief Solve for X
     * @param A Matrix A
     * @param X Vector X
     * @param Z Vector Z
+    * @param refactor How much of the factorization to redo
     * @return True if solution is found, false otherwise
     */
-  bool solve_for_x(Eigen::MatrixXd &A, Eigen::VectorXd &X, Eigen::VectorXd &Z)
+  bool solve_for_x(const Eigen::SparseMatrix<double> &A, Eigen::VectorXd &X, const Eigen::VectorXd &Z, Refactor refactor = Refactor::FULL)
   {
-    X = A.colPivHouseholderQr().solve(Z);
+    SolveProfile *profile = profiling();
+    if (refactor != Refactor::NONE)
+    {
+      PhaseTimer timer(profile, Phase::FACTORIZATION);
+      if (!(refactor == Refactor::FULL ? _solver.factorize(A) : _solver.refactorize(A)))
+        return false;
+    }
+    {
+      PhaseTimer timer(profile, Phase::SOLVE);
+      //Iterative backends and mixed precision refinement may not converge, retry with a direct double factorization
+      if (!_solver.solve(Z, X) && !(_solver.fall_back() && _solver.solve(Z, X)))
+        return false;
+    }
 
-    std::cout << '\n';
-    for (int i = 0; i < X.size(); i++) std::cout << X(i) << " ";
+    if (_verbose)
+    {
+      std::cout << "\nBackend: " << backend_name(_solver.backend()) << (_solver.single_precision() ? " (mixed precision)" : "")
+                << '\n';
+      for (int i = 0; i < X.size(); i++) std::cout << X(i) << " ";
+    }
 
-    size_t num_nodes = _nodes.size() - 1;
+    write_back(X.data());
+    return true;
+  }
 
-    for (auto node : _nodes)
-      if (!node->is_ground())
-        node->set_voltage(X(node->id()));
+  /*
+    * @brief Fill resultant X values to nodes and voltage sources
+    * @param X Values of the unknowns
+    */
+  void write_back(const double *X)
+  {
+    PhaseTimer timer(profiling(), Phase::WRITE_BACK);
+    size_t num_nodes = _num_node_unknowns;
+
+    //Nodes that share the ground's unknown through an op-amp are at 0 V too
+    for (auto node : _nodes) node->set_voltage(index_of(node) == no_unknown ? 0.0 : X[index_of(node)]);
 
     for (auto voltage_source : _voltage_sources)
     {
       VoltageSource *v_source = static_cast<VoltageSource *>(voltage_source);
-      v_source->set_current(X(num_nodes + v_source->id()));
+      v_source->set_current(X[num_nodes + v_source->id()]);
     }
 
-    return true;
-  }
-
-  static double solve_parallel(Node *node_1, Node *node_2)
-  {
-    double sum = 0;
+    //VCCS and CCCS currents follow from the node voltages and branch currents when asked for
+    for (auto source : _dependent_sources)
+      if (source->id() >= 0)
+        source->set_current(X[num_nodes + source->id()]);
 
-    for (auto elem : node_1->elements())
-      if (elem->get_other_node(node_1) == node_2 && elem->type() == Type::RESISTOR)
-        sum = sum + (1 / elem->value());
+    for (auto inductor : _inductors) inductor->set_current(X[num_nodes + inductor->id()]);
 
-    return 1 / sum;
+    for (auto element : _switches) element->set_current(X[num_nodes + element->id()]);
   }
 
-  static size_t num_common_resistors(Node *node_1, Node *node_2)
-  {
-    size_t num = 0;
-    for (auto elem : node_1->elements())
-      if (elem->get_other_node(node_1) == node_2)
-        num++;
-    return num;
-  }
+  /*
+    * @brief Profile to record into, or nullptr when profiling is off
+    */
+  SolveProfile *profiling() { return _profiling ? &_profile : nullptr; }
 };
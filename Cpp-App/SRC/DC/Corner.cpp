@@ -0,0 +1,159 @@
+#include "Corner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Circuit.hpp"
+#include "Parallel.hpp"
+
+CornerAnalysis::CornerAnalysis(Circuit &circuit, double tolerance)
+    : _circuit(circuit), _tolerances(circuit.elements().size(), tolerance), _flips(default_flips), _threads(0), _evaluated(0)
+{
+  //A switch state is not a value with a tolerance
+  for (auto element : circuit.elements())
+    if (element->type() == Type::SWITCH || element->type() == Type::FUSE)
+      _tolerances[element->index()] = 0.0;
+}
+
+std::vector<double> CornerAnalysis::corner_values(const std::vector<int8_t> &signs, const std::vector<double> &nominal) const
+{
+  std::vector<double> values(nominal.size());
+  for (size_t i = 0; i < nominal.size(); i++) values[i] = nominal[i] * (1.0 + signs[i] * _tolerances[i]);
+  return values;
+}
+
+void CornerAnalysis::evaluate(const std::vector<std::vector<int8_t>> &signs, const std::vector<double> &nominal,
+                              const std::vector<size_t> &ids, std::vector<double> &voltages)
+{
+  const size_t count = signs.size();
+  voltages.assign(count * ids.size(), std::numeric_limits<double>::quiet_NaN());
+
+  //Every thread factorizes in its own workspace. The workspaces are seeded with the ordering of the circuit's
+  //factorization from run(), so the pattern is analyzed once for all of them and each candidate is a numeric refactor
+  std::vector<LinearSolver> workspaces;
+  for (size_t i = parallel_threads(count, _threads); i > 0; i--) workspaces.push_back(_circuit.make_workspace());
+  auto solve = [&](size_t i, size_t worker)
+  {
+    Solution solution = _circuit.evaluate(corner_values(signs[i], nominal), workspaces[worker]);
+    if (solution.found)
+      for (size_t k = 0; k < ids.size(); k++) voltages[i * ids.size() + k] = solution.voltage(ids[k]);
+  };
+  parallel_for(count, _threads, solve);
+  _evaluated += count;
+}
+
+std::vector<Corner> CornerAnalysis::run(const std::vector<std::string> &outputs)
+{
+  _evaluated = 0;
+  std::vector<Corner> corners;
+  if (!_circuit.is_compiled())
+    _circuit.compile();
+  Sensitivity sensitivity = _circuit.sensitivities(outputs);
+  if (!sensitivity.found)
+    return corners;
+
+  const auto &elements = _circuit.elements();
+  const size_t m = elements.size();
+  const size_t num_outputs = outputs.size();
+  std::vector<double> nominal(m);
+  for (size_t i = 0; i < m; i++) nominal[i] = elements[i]->value();
+  std::vector<Node *> nodes;
+  std::vector<size_t> ids;
+  for (auto &name : outputs)
+  {
+    nodes.push_back(_circuit.get_node(name));
+    ids.push_back(nodes.back()->id());
+  }
+
+  //Corner 2k is the lowest voltage of output k, 2k + 1 the highest. Each gets its sign corner, then the sign corner
+  //with one of its least influential elements flipped
+  std::vector<std::vector<int8_t>> candidates;
+  std::vector<size_t> base(2 * num_outputs);
+  std::vector<std::vector<size_t>> flipped(2 * num_outputs);
+  corners.resize(2 * num_outputs);
+  for (size_t c = 0; c < corners.size(); c++)
+  {
+    const size_t k = c / 2;
+    const int direction = c % 2 ? 1 : -1;
+    const double *row = sensitivity.row(k);
+    Corner &corner = corners[c];
+    corner.output = outputs[k];
+    corner.maximum = direction > 0;
+    corner.estimate = nodes[k]->voltage();
+
+    std::vector<int8_t> signs(m, 0);
+    std::vector<std::pair<double, size_t>> influence;
+    for (size_t i = 0; i < m; i++)
+    {
+      //Moving element i by its tolerance moves the output by about row[i] * nominal[i] * tolerance, in either direction
+      double swing = std::abs(row[i] * nominal[i] * _tolerances[i]);
+      if (swing == 0.0)
+        continue;
+      signs[i] = (row[i] * nominal[i] > 0) == (direction > 0) ? 1 : -1;
+      corner.estimate += direction * swing;
+      influence.emplace_back(swing, i);
+    }
+
+    base[c] = candidates.size();
+    candidates.push_back(signs);
+    size_t flips = std::min(_flips, influence.size());
+    std::partial_sort(influence.begin(), influence.begin() + flips, influence.end());
+    for (size_t j = 0; j < flips; j++)
+    {
+      flipped[c].push_back(influence[j].second);
+      candidates.push_back(signs);
+      candidates.back()[influence[j].second] *= -1;
+    }
+  }
+
+  std::vector<double> voltages;
+  evaluate(candidates, nominal, ids, voltages);
+
+  //Flips that beat the sign corner on their own are combined into one more candidate per corner
+  std::vector<std::vector<int8_t>> combined;
+  for (size_t c = 0; c < corners.size(); c++)
+  {
+    const size_t k = c / 2;
+    const double direction = c % 2 ? 1.0 : -1.0;
+    const double at_base = voltages[base[c] * num_outputs + k];
+    std::vector<int8_t> signs = candidates[base[c]];
+    size_t improving = 0;
+    for (size_t j = 0; j < flipped[c].size(); j++)
+      if (direction * voltages[(base[c] + 1 + j) * num_outputs + k] > direction * at_base)
+      {
+        signs[flipped[c][j]] *= -1;
+        improving++;
+      }
+    if (improving > 1)
+      combined.push_back(std::move(signs));
+  }
+  std::vector<double> combined_voltages;
+  evaluate(combined, nominal, ids, combined_voltages);
+  candidates.insert(candidates.end(), combined.begin(), combined.end());
+  voltages.insert(voltages.end(), combined_voltages.begin(), combined_voltages.end());
+
+  //Every solved candidate is a valid corner for every output, so each corner takes the best of all of them
+  for (size_t c = 0; c < corners.size(); c++)
+  {
+    const size_t k = c / 2;
+    const double direction = c % 2 ? 1.0 : -1.0;
+    Corner &corner = corners[c];
+    size_t best = candidates.size();
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+      double voltage = voltages[i * num_outputs + k];
+      if (!std::isnan(voltage) && (best == candidates.size() || direction * voltage > direction * corner.voltage))
+      {
+        best = i;
+        corner.voltage = voltage;
+      }
+    }
+    if (best == candidates.size())
+      continue;
+    corner.found = true;
+    corner.signs = candidates[best];
+    corner.values = corner_values(corner.signs, nominal);
+  }
+  return corners;
+}
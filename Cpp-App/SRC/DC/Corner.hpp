@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Circuit;
+
+/**
+ * @struct Corner
+ * @brief Extreme voltage of one output when every element may take any value within its tolerance.
+ */
+struct Corner
+{
+  std::string output;          ///< Name of the output node
+  bool maximum = false;        ///< True for the highest voltage, false for the lowest
+  bool found = false;          ///< False if no candidate of this corner could be solved
+  double voltage = 0.0;        ///< Voltage of the output at the corner, from a full solve
+  double estimate = 0.0;       ///< Voltage predicted by the nominal sensitivities alone
+  std::vector<int8_t> signs;   ///< Per element: +1 at the top of its tolerance, -1 at the bottom, 0 at nominal
+  std::vector<double> values;  ///< Element values at the corner, indexed by Element::index()
+};
+
+/**
+ * @class CornerAnalysis
+ * @brief Worst-case corners of some node voltages over the tolerances of the element values.
+ *
+ * Instead of enumerating all 2^k combinations, the sign of each element's sensitivity at nominal picks the side of its
+ * tolerance that pushes an output up or down. That corner is exact for a linear dependence; to catch the elements whose
+ * sign is wrong away from nominal, the elements with the least influence are flipped one at a time, the flips that
+ * help are combined, and every candidate is checked with a full solve. Candidates are solved in parallel through
+ * Circuit::evaluate, each thread reusing the symbolic analysis of its own workspace on the compiled pattern.
+ */
+class CornerAnalysis
+{
+  Circuit &_circuit;                ///< Circuit analyzed, compiled by run()
+  std::vector<double> _tolerances;  ///< Relative tolerance of each element by Element::index()
+  size_t _flips;                    ///< Elements flipped one at a time around each sign corner
+  size_t _threads;                  ///< Threads solving candidates, 0 for one per core
+  size_t _evaluated;                ///< Candidates solved by the last run
+
+public:
+  static constexpr size_t default_flips = 16;  ///< Default number of single flips tried per corner
+
+  /**
+     * @brief Constructor for CornerAnalysis.
+     * @param circuit Circuit to analyze, its structure must not change while the analysis is used.
+     * @param tolerance Relative tolerance of every element, 0.05 for 5%.
+     */
+  CornerAnalysis(Circuit &circuit, double tolerance);
+
+  /**
+     * @brief Sets the relative tolerance of one element, 0 to hold it at its nominal value (a supply, say).
+     * @param index Element::index() of the element.
+     * @param tolerance Relative tolerance.
+     */
+  void set_tolerance(size_t index, double tolerance) { _tolerances[index] = tolerance; }
+
+  /**
+     * @brief Sets how many of the least influential elements are flipped one at a time around each sign corner.
+     * @param flips Number of single flips, 0 to trust the signs alone.
+     */
+  void set_flips(size_t flips) { _flips = flips; }
+
+  /**
+     * @brief Sets the number of threads solving candidates.
+     * @param threads Number of threads, 0 for one per core.
+     */
+  void set_threads(size_t threads) { _threads = threads; }
+
+  /**
+     * @brief Gets the number of candidate corners solved by the last run.
+     */
+  size_t evaluated() const { return _evaluated; }
+
+  /**
+     * @brief Finds the lowest and highest voltage of every output. Compiles the circuit if needed and leaves it solved
+     * at nominal.
+     * @param outputs Names of the output nodes.
+     * @return Minimum then maximum corner of each output, empty if the nominal circuit has no solution.
+     */
+  std::vector<Corner> run(const std::vector<std::string> &outputs);
+
+private:
+  /**
+     * @brief Solves candidate corners in parallel.
+     * @param signs Side of the tolerance of every element, one vector per candidate.
+     * @param nominal Nominal values of the elements.
+     * @param ids Node::id() of each output.
+     * @param voltages Set to the output voltages of each candidate, one row of outputs per candidate, NaN if unsolved.
+     */
+  void evaluate(const std::vector<std::vector<int8_t>> &signs, const std::vector<double> &nominal,
+                const std::vector<size_t> &ids, std::vector<double> &voltages);
+
+  /**
+     * @brief Gets the element values of a corner.
+     * @param signs Side of the tolerance of every element.
+     * @param nominal Nominal values of the elements.
+     * @return Values indexed by Element::index().
+     */
+  std::vector<double> corner_values(const std::vector<int8_t> &signs, const std::vector<double> &nominal) const;
+};
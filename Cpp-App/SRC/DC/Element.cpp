@@ -4,7 +4,14 @@
 // Element class definitions
 
 Element::Element(Type type, std::string name, double value)
-    : _type(type), _name(std::move(name)), _pos_node(nullptr), _neg_node(nullptr), _value(value)
+    : _type(type),
+      _name(std::move(name)),
+      _pos_node(nullptr),
+      _neg_node(nullptr),
+      _value(value),
+      _index(0),
+      _dirty(false),
+      _dirty_list(nullptr)
 {
 }
 
@@ -39,13 +46,39 @@ Type Element::type() const { return _type; }
 
 double Element::value() const { return _value; }
 
+size_t Element::index() const { return _index; }
+
+void Element::set_index(size_t index) { _index = index; }
+
+void Element::watch(std::vector<Element *> *dirty_list)
+{
+  _dirty_list = dirty_list;
+  _dirty = false;
+}
+
+void Element::clear_dirty() { _dirty = false; }
+
+void Element::set_value(double value)
+{
+  _value = value;
+  if (_dirty_list != nullptr && !_dirty)
+  {
+    _dirty = true;
+    _dirty_list->push_back(this);
+  }
+}
+
 // Resistor class definitions
 
 Resistor::Resistor(std::string name, double resistance) : Element(Type::RESISTOR, std::move(name), resistance), _resistance(resistance) {}
 
 double Resistor::resistance() const { return _resistance; }
 
-void Resistor::set_resistance(double resistance) { _resistance = resistance; }
+void Resistor::set_resistance(double resistance)
+{
+  _resistance = resistance;
+  set_value(resistance);
+}
 
 double Resistor::get_current() const
 {
@@ -61,7 +94,11 @@ VoltageSource::VoltageSource(std::string name, double voltage, int id)
 
 double VoltageSource::voltage() const { return _voltage; }
 
-void VoltageSource::set_voltage(double voltage) { _voltage = voltage; }
+void VoltageSource::set_voltage(double voltage)
+{
+  _voltage = voltage;
+  set_value(voltage);
+}
 
 double VoltageSource::get_current() const { return _current; }
 
@@ -69,6 +106,8 @@ void VoltageSource::set_current(double current) { _current = current; }
 
 int VoltageSource::id() const { return _volt_source_id; }
 
+void VoltageSource::set_id(int id) { _volt_source_id = id; }
+
 // CurrentSource class definitions
 
 CurrentSource::CurrentSource(std::string name, double current, int id)
@@ -78,4 +117,196 @@ CurrentSource::CurrentSource(std::string name, double current, int id)
 
 double CurrentSource::current() const { return _current; }
 
+void CurrentSource::set_current(double current)
+{
+  _current = current;
+  set_value(current);
+}
+
 int CurrentSource::id() const { return _current_source_id; }
+
+// DependentSource class definitions
+
+DependentSource::DependentSource(std::string name, Dependence dependence, double gain, int branch_id)
+    : Element(dependence == Dependence::VCVS || dependence == Dependence::CCVS ? Type::DEPENDENT_VOLTAGE_SOURCE : Type::DEPENDENT_CURRENT_SOURCE,
+              std::move(name), gain),
+      _dependence(dependence),
+      _gain(gain),
+      _control_pos(nullptr),
+      _control_neg(nullptr),
+      _control(nullptr),
+      _branch_id(branch_id),
+      _current(0.0)
+{
+}
+
+Dependence DependentSource::dependence() const { return _dependence; }
+
+bool DependentSource::voltage_controlled() const { return _dependence == Dependence::VCVS || _dependence == Dependence::VCCS; }
+
+double DependentSource::gain() const { return _gain; }
+
+void DependentSource::set_gain(double gain)
+{
+  _gain = gain;
+  set_value(gain);
+}
+
+void DependentSource::set_control_nodes(Node *pos, Node *neg)
+{
+  _control_pos = pos;
+  _control_neg = neg;
+}
+
+Node *DependentSource::control_pos() const { return _control_pos; }
+
+Node *DependentSource::control_neg() const { return _control_neg; }
+
+void DependentSource::set_control_name(std::string name) { _control_name = std::move(name); }
+
+const std::string &DependentSource::control_name() const { return _control_name; }
+
+void DependentSource::set_control(Element *control) { _control = control; }
+
+Element *DependentSource::control() const { return _control; }
+
+int DependentSource::id() const { return _branch_id; }
+
+void DependentSource::set_id(int id) { _branch_id = id; }
+
+double DependentSource::get_current() const
+{
+  switch (_dependence)
+  {
+    case Dependence::VCCS: return _control_pos && _control_neg ? _gain * (_control_pos->voltage() - _control_neg->voltage()) : 0.0;
+    case Dependence::CCCS: return _gain * branch_current(_control);
+    default: return _current;
+  }
+}
+
+void DependentSource::set_current(double current) { _current = current; }
+
+// OpAmp class definitions
+
+OpAmp::OpAmp(std::string name) : Element(Type::OPAMP, std::move(name), 0.0), _output(nullptr), _reference(nullptr) {}
+
+void OpAmp::set_output(Node *node)
+{
+  _output = node;
+  _output->add_element(this);
+}
+
+Node *OpAmp::output() const { return _output; }
+
+void OpAmp::set_reference(Node *node)
+{
+  _reference = node;
+  if (_reference != nullptr)
+    _reference->add_element(this);
+}
+
+Node *OpAmp::reference() const { return _reference; }
+
+// Capacitor class definitions
+
+Capacitor::Capacitor(std::string name, double capacitance) : Element(Type::CAPACITOR, std::move(name), capacitance) {}
+
+double Capacitor::capacitance() const { return value(); }
+
+void Capacitor::set_capacitance(double capacitance) { set_value(capacitance); }
+
+// Inductor class definitions
+
+Inductor::Inductor(std::string name, double inductance, int branch_id)
+    : Element(Type::INDUCTOR, std::move(name), inductance), _branch_id(branch_id), _current(0.0)
+{
+}
+
+double Inductor::inductance() const { return value(); }
+
+void Inductor::set_inductance(double inductance) { set_value(inductance); }
+
+int Inductor::id() const { return _branch_id; }
+
+void Inductor::set_id(int id) { _branch_id = id; }
+
+double Inductor::get_current() const { return _current; }
+
+void Inductor::set_current(double current) { _current = current; }
+
+// Switch class definitions
+
+Switch::Switch(std::string name, bool closed, int branch_id) : Switch(Type::SWITCH, std::move(name), closed, branch_id) {}
+
+Switch::Switch(Type type, std::string name, bool closed, int branch_id)
+    : Element(type, std::move(name), closed ? 1.0 : 0.0), _branch_id(branch_id), _current(0.0)
+{
+}
+
+bool Switch::closed() const { return value() != 0.0; }
+
+void Switch::set_closed(bool closed) { set_value(closed ? 1.0 : 0.0); }
+
+int Switch::id() const { return _branch_id; }
+
+void Switch::set_id(int id) { _branch_id = id; }
+
+double Switch::get_current() const { return _current; }
+
+void Switch::set_current(double current) { _current = current; }
+
+// Fuse class definitions
+
+Fuse::Fuse(std::string name, double rating, int branch_id) : Switch(Type::FUSE, std::move(name), true, branch_id), _rating(rating) {}
+
+double Fuse::rating() const { return _rating; }
+
+void Fuse::replace(double rating)
+{
+  _rating = rating;
+  set_closed(true);
+}
+
+bool Fuse::blown() const { return !closed(); }
+
+double branch_current(const Element *element)
+{
+  if (element == nullptr)
+    return 0.0;
+  if (element->type() == Type::VOLTAGE_SUPPLY)
+    return static_cast<const VoltageSource *>(element)->get_current();
+  if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE)
+    return static_cast<const DependentSource *>(element)->get_current();
+  if (element->type() == Type::INDUCTOR)
+    return static_cast<const Inductor *>(element)->get_current();
+  if (element->type() == Type::SWITCH || element->type() == Type::FUSE)
+    return static_cast<const Switch *>(element)->get_current();
+  return 0.0;
+}
+
+int branch_id(const Element *element)
+{
+  if (element == nullptr)
+    return -1;
+  if (element->type() == Type::VOLTAGE_SUPPLY)
+    return static_cast<const VoltageSource *>(element)->id();
+  if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE)
+    return static_cast<const DependentSource *>(element)->id();
+  if (element->type() == Type::INDUCTOR)
+    return static_cast<const Inductor *>(element)->id();
+  if (element->type() == Type::SWITCH || element->type() == Type::FUSE)
+    return static_cast<const Switch *>(element)->id();
+  return -1;
+}
+
+void set_branch_id(Element *element, int id)
+{
+  if (element->type() == Type::VOLTAGE_SUPPLY)
+    static_cast<VoltageSource *>(element)->set_id(id);
+  else if (element->type() == Type::DEPENDENT_VOLTAGE_SOURCE)
+    static_cast<DependentSource *>(element)->set_id(id);
+  else if (element->type() == Type::INDUCTOR)
+    static_cast<Inductor *>(element)->set_id(id);
+  else if (element->type() == Type::SWITCH || element->type() == Type::FUSE)
+    static_cast<Switch *>(element)->set_id(id);
+}
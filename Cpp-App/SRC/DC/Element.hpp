@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include "Node.hpp"
 
@@ -15,6 +17,21 @@ enum class Type
   CURRENT_SOURCE,
   DEPENDENT_VOLTAGE_SOURCE,
   DEPENDENT_CURRENT_SOURCE,
+  OPAMP,
+  CAPACITOR,
+  INDUCTOR,
+  SWITCH,
+  FUSE,
+};
+
+/**
+ * @enum Terminal
+ * @brief One of the two terminals of an element.
+ */
+enum class Terminal
+{
+  POS,
+  NEG,
 };
 
 /**
@@ -24,11 +41,14 @@ enum class Type
 class Element
 {
 private:
-  Type _type;         ///< Type of the element
-  std::string _name;  ///< Name of the element
-  Node *_pos_node;    ///< Positive node
-  Node *_neg_node;    ///< Negative node
-  double _value;      ///< Value associated with the element
+  Type _type;                           ///< Type of the element
+  std::string _name;                    ///< Name of the element
+  Node *_pos_node;                      ///< Positive node
+  Node *_neg_node;                      ///< Negative node
+  double _value;                        ///< Value associated with the element
+  size_t _index;                        ///< Position of the element in its circuit
+  bool _dirty;                          ///< True if the value changed since the circuit last stamped it
+  std::vector<Element *> *_dirty_list;  ///< Where value changes are reported, set while the circuit is compiled
 
 public:
   /**
@@ -92,6 +112,37 @@ public:
      * @return Value of the element.
      */
   double value() const;
+
+  /**
+     * @brief Gets the position of the element in its circuit.
+     * @return Index of the element.
+     */
+  size_t index() const;
+
+  /**
+     * @brief Sets the position of the element in its circuit, called by Circuit when the element is added.
+     * @param index Index of the element.
+     */
+  void set_index(size_t index);
+
+  /**
+     * @brief Reports later value changes to a list, once per change until cleared. Used by compiled circuits to restamp
+     * only what changed.
+     * @param dirty_list List to report to, nullptr to stop reporting.
+     */
+  void watch(std::vector<Element *> *dirty_list);
+
+  /**
+     * @brief Marks the current value as stamped.
+     */
+  void clear_dirty();
+
+protected:
+  /**
+     * @brief Sets the value associated with the element, used by the solver when stamping.
+     * @param value New value of the element.
+     */
+  void set_value(double value);
 };
 
 /**
@@ -179,6 +230,12 @@ public:
      * @return Voltage source identifier.
      */
   int id() const;
+
+  /**
+     * @brief Sets the branch current identifier, used when the circuit renumbers its branches.
+     * @param id New identifier.
+     */
+  void set_id(int id);
 };
 
 /**
@@ -206,9 +263,407 @@ public:
      */
   double current() const;
 
+  /**
+     * @brief Sets the current value.
+     * @param current New current value.
+     */
+  void set_current(double current);
+
   /**
      * @brief Gets the current source identifier.
      * @return Current source identifier.
      */
   int id() const;
 };
+
+/**
+ * @enum Dependence
+ * @brief What controls a dependent source and what it drives.
+ */
+enum class Dependence
+{
+  VCVS,  ///< Voltage controlled voltage source, vpos - vneg = gain * (v(control pos) - v(control neg))
+  VCCS,  ///< Voltage controlled current source, current = gain * (v(control pos) - v(control neg))
+  CCVS,  ///< Current controlled voltage source, vpos - vneg = gain * current of the control element
+  CCCS,  ///< Current controlled current source, current = gain * current of the control element
+};
+
+/**
+ * @class DependentSource
+ * @brief Class representing a controlled source. Its type is DEPENDENT_VOLTAGE_SOURCE for VCVS and CCVS, which add a
+ * branch current unknown like a voltage source, and DEPENDENT_CURRENT_SOURCE for VCCS and CCCS, which only stamp A.
+ * The value of the element is its gain. Currents follow SPICE: they flow from the positive node through the source to
+ * the negative node, and a controlling current is the current of a voltage source (or of a VCVS or CCVS) measured
+ * the same way.
+ */
+class DependentSource : public Element
+{
+private:
+  Dependence _dependence;     ///< Kind of control and output
+  double _gain;               ///< Gain, dimensionless or in siemens or ohms depending on the kind
+  Node *_control_pos;         ///< Positive controlling node of VCVS and VCCS
+  Node *_control_neg;         ///< Negative controlling node of VCVS and VCCS
+  std::string _control_name;  ///< Name of the controlling element of CCVS and CCCS
+  Element *_control;          ///< Controlling element once resolved by the circuit, nullptr before
+  int _branch_id;             ///< Branch current identifier of VCVS and CCVS, shared with voltage sources; -1 otherwise
+  double _current;            ///< Solved branch current of VCVS and CCVS
+
+public:
+  /**
+     * @brief Constructor for DependentSource.
+     * @param name Name of the source.
+     * @param dependence Kind of control and output.
+     * @param gain Gain of the source.
+     * @param branch_id Branch current identifier for VCVS and CCVS, -1 for VCCS and CCCS.
+     */
+  DependentSource(std::string name, Dependence dependence, double gain, int branch_id);
+
+  /**
+     * @brief Gets the kind of control and output.
+     * @return Dependence of the source.
+     */
+  Dependence dependence() const;
+
+  /**
+     * @brief Checks if the source is controlled by a node voltage difference.
+     * @return True for VCVS and VCCS.
+     */
+  bool voltage_controlled() const;
+
+  /**
+     * @brief Gets the gain.
+     * @return Gain of the source.
+     */
+  double gain() const;
+
+  /**
+     * @brief Sets the gain.
+     * @param gain New gain.
+     */
+  void set_gain(double gain);
+
+  /**
+     * @brief Sets the controlling nodes of a VCVS or VCCS.
+     * @param pos Positive controlling node.
+     * @param neg Negative controlling node.
+     */
+  void set_control_nodes(Node *pos, Node *neg);
+
+  /**
+     * @brief Gets the positive controlling node.
+     * @return Pointer to the node, nullptr for current controlled sources.
+     */
+  Node *control_pos() const;
+
+  /**
+     * @brief Gets the negative controlling node.
+     * @return Pointer to the node, nullptr for current controlled sources.
+     */
+  Node *control_neg() const;
+
+  /**
+     * @brief Sets the name of the controlling element of a CCVS or CCCS, resolved when the circuit is stamped.
+     * @param name Name of the element.
+     */
+  void set_control_name(std::string name);
+
+  /**
+     * @brief Gets the name of the controlling element.
+     * @return Name of the element, empty for voltage controlled sources.
+     */
+  const std::string &control_name() const;
+
+  /**
+     * @brief Sets the controlling element, called by Circuit when it resolves the control name.
+     * @param control Voltage source, VCVS or CCVS whose current controls this source.
+     */
+  void set_control(Element *control);
+
+  /**
+     * @brief Gets the controlling element.
+     * @return Pointer to the element, nullptr if not resolved.
+     */
+  Element *control() const;
+
+  /**
+     * @brief Gets the branch current identifier.
+     * @return Identifier shared with voltage sources, -1 for VCCS and CCCS.
+     */
+  int id() const;
+
+  /**
+     * @brief Sets the branch current identifier, used when the circuit renumbers its branches.
+     * @param id New identifier.
+     */
+  void set_id(int id);
+
+  /**
+     * @brief Calculates the current through the source, from the positive to the negative node.
+     * @return Current of the source.
+     */
+  double get_current() const;
+
+  /**
+     * @brief Sets the solved branch current of a VCVS or CCVS.
+     * @param current Current value.
+     */
+  void set_current(double current);
+};
+
+/**
+ * @class OpAmp
+ * @brief Class representing an ideal op-amp, modelled as a nullor. The nullator across the inputs (pos and neg nodes)
+ * forces equal input voltages and draws no current, the norator from the output to the reference node supplies
+ * whatever current that takes. Neither adds an unknown: the circuit merges the voltage unknowns of the two inputs and
+ * the KCL rows of the output and reference, so every op-amp removes one unknown and one equation from the system.
+ * The element has no value and stamps nothing.
+ */
+class OpAmp : public Element
+{
+private:
+  Node *_output;     ///< Output node
+  Node *_reference;  ///< Node the output current returns through, nullptr for the ground of the circuit
+
+public:
+  /**
+     * @brief Constructor for OpAmp.
+     * @param name Name of the op-amp.
+     */
+  explicit OpAmp(std::string name);
+
+  /**
+     * @brief Sets the output node.
+     * @param node Pointer to the output node.
+     */
+  void set_output(Node *node);
+
+  /**
+     * @brief Gets the output node.
+     * @return Pointer to the output node.
+     */
+  Node *output() const;
+
+  /**
+     * @brief Sets the reference node of the output.
+     * @param node Pointer to the reference node, nullptr for the ground of the circuit.
+     */
+  void set_reference(Node *node);
+
+  /**
+     * @brief Gets the reference node of the output.
+     * @return Pointer to the reference node, nullptr for the ground of the circuit.
+     */
+  Node *reference() const;
+};
+
+/**
+ * @class Capacitor
+ * @brief Class representing a capacitor. It is an open circuit for DC solves and only stamps the C matrix of the
+ * MNA pencil G + s * C.
+ */
+class Capacitor : public Element
+{
+public:
+  /**
+     * @brief Constructor for Capacitor.
+     * @param name Name of the capacitor.
+     * @param capacitance Capacitance in farads.
+     */
+  Capacitor(std::string name, double capacitance);
+
+  /**
+     * @brief Gets the capacitance.
+     * @return Capacitance in farads.
+     */
+  double capacitance() const;
+
+  /**
+     * @brief Sets the capacitance.
+     * @param capacitance New capacitance in farads.
+     */
+  void set_capacitance(double capacitance);
+};
+
+/**
+ * @class Inductor
+ * @brief Class representing an inductor. It adds a branch current unknown like a voltage source: for DC solves its
+ * branch row reads vpos - vneg = 0, a short, and in the MNA pencil it becomes vpos - vneg - s * L * current = 0.
+ */
+class Inductor : public Element
+{
+private:
+  int _branch_id;   ///< Branch current identifier, shared with voltage sources
+  double _current;  ///< Solved current from the positive node through the inductor
+
+public:
+  /**
+     * @brief Constructor for Inductor.
+     * @param name Name of the inductor.
+     * @param inductance Inductance in henries.
+     * @param branch_id Branch current identifier.
+     */
+  Inductor(std::string name, double inductance, int branch_id);
+
+  /**
+     * @brief Gets the inductance.
+     * @return Inductance in henries.
+     */
+  double inductance() const;
+
+  /**
+     * @brief Sets the inductance.
+     * @param inductance New inductance in henries.
+     */
+  void set_inductance(double inductance);
+
+  /**
+     * @brief Gets the branch current identifier.
+     * @return Identifier shared with voltage sources.
+     */
+  int id() const;
+
+  /**
+     * @brief Sets the branch current identifier, used when the circuit renumbers its branches.
+     * @param id New identifier.
+     */
+  void set_id(int id);
+
+  /**
+     * @brief Gets the solved current, from the positive node through the inductor.
+     * @return Current of the inductor.
+     */
+  double get_current() const;
+
+  /**
+     * @brief Sets the solved current.
+     * @param current Current value.
+     */
+  void set_current(double current);
+};
+
+/**
+ * @class Switch
+ * @brief Class representing an ideal switch. It owns a branch current unknown whose row reads vpos - vneg = 0 when
+ * closed and current = 0 when open, so both states have the same sparsity pattern. The value is 1 closed, 0 open.
+ */
+class Switch : public Element
+{
+private:
+  int _branch_id;   ///< Branch current identifier, shared with voltage sources
+  double _current;  ///< Solved current from the positive node through the switch
+
+public:
+  /**
+     * @brief Constructor for Switch.
+     * @param name Name of the switch.
+     * @param closed Initial state.
+     * @param branch_id Branch current identifier.
+     */
+  Switch(std::string name, bool closed, int branch_id);
+
+  /**
+     * @brief Checks if the switch conducts.
+     * @return True if closed.
+     */
+  bool closed() const;
+
+  /**
+     * @brief Opens or closes the switch.
+     * @param closed New state.
+     */
+  void set_closed(bool closed);
+
+  /**
+     * @brief Gets the branch current identifier.
+     * @return Identifier shared with voltage sources.
+     */
+  int id() const;
+
+  /**
+     * @brief Sets the branch current identifier, used when the circuit renumbers its branches.
+     * @param id New identifier.
+     */
+  void set_id(int id);
+
+  /**
+     * @brief Gets the solved current, from the positive node through the switch.
+     * @return Current of the switch, 0 when open.
+     */
+  double get_current() const;
+
+  /**
+     * @brief Sets the solved current.
+     * @param current Current value.
+     */
+  void set_current(double current);
+
+protected:
+  /**
+     * @brief Constructor for elements that behave as a switch.
+     * @param type Type of the element.
+     * @param name Name of the element.
+     * @param closed Initial state.
+     * @param branch_id Branch current identifier.
+     */
+  Switch(Type type, std::string name, bool closed, int branch_id);
+};
+
+/**
+ * @class Fuse
+ * @brief Class representing an ideal fuse: a closed switch that the circuit opens after a solve in which the magnitude
+ * of its current exceeds the rating. It stays open until replaced.
+ */
+class Fuse : public Switch
+{
+private:
+  double _rating;  ///< Largest current magnitude the fuse carries, in amperes
+
+public:
+  /**
+     * @brief Constructor for Fuse.
+     * @param name Name of the fuse.
+     * @param rating Rating in amperes.
+     * @param branch_id Branch current identifier.
+     */
+  Fuse(std::string name, double rating, int branch_id);
+
+  /**
+     * @brief Gets the rating.
+     * @return Rating in amperes.
+     */
+  double rating() const;
+
+  /**
+     * @brief Replaces the fuse with a new one, closed.
+     * @param rating Rating of the new fuse in amperes.
+     */
+  void replace(double rating);
+
+  /**
+     * @brief Checks if the fuse has blown.
+     * @return True if open.
+     */
+  bool blown() const;
+};
+
+/**
+ * @brief Gets the current of an element that owns a branch current unknown.
+ * @param element Voltage source, dependent voltage source, inductor, switch or fuse.
+ * @return Current from the positive node through the element, 0 for other elements.
+ */
+double branch_current(const Element *element);
+
+/**
+ * @brief Gets the branch current identifier of an element.
+ * @param element Any element.
+ * @return Identifier shared by voltage sources, VCVS, CCVS, inductors, switches and fuses, -1 for other elements.
+ */
+int branch_id(const Element *element);
+
+/**
+ * @brief Sets the branch current identifier of a voltage source, VCVS, CCVS, inductor, switch or fuse, does nothing for
+ * others.
+ * @param element Element.
+ * @param id New identifier.
+ */
+void set_branch_id(Element *element, int id);
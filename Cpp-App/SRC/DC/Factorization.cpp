@@ -0,0 +1,42 @@
+#include "Factorization.hpp"
+
+#include <algorithm>
+#include <bit>
+
+FactorizationCache::FactorizationCache(size_t capacity) : _capacity(capacity), _hits(0), _misses(0) {}
+
+bool FactorizationCache::take(const Key &key, LinearSolver &solver)
+{
+  auto it = std::find_if(_entries.begin(), _entries.end(), [&key](const auto &entry) { return entry.first == key; });
+  if (it == _entries.end())
+  {
+    _misses++;
+    return false;
+  }
+  _hits++;
+  solver = std::move(it->second);
+  _entries.erase(it);
+  return true;
+}
+
+void FactorizationCache::put(const Key &key, LinearSolver &&solver)
+{
+  if (_capacity == 0)
+    return;
+  _entries.remove_if([&key](const auto &entry) { return entry.first == key; });
+  _entries.emplace_front(key, std::move(solver));
+  while (_entries.size() > _capacity) _entries.pop_back();
+}
+
+void FactorizationCache::set_capacity(size_t capacity)
+{
+  _capacity = capacity;
+  while (_entries.size() > _capacity) _entries.pop_back();
+}
+
+size_t FactorizationCache::distance(const Key &a, const Key &b)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < a.size() && i < b.size(); i++) count += std::popcount(a[i] ^ b[i]);
+  return count;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include "Solver.hpp"
+
+/**
+ * @class FactorizationCache
+ * @brief Least recently used set of factorizations of one circuit, keyed by the states of its switches and fuses.
+ *
+ * Every switch state gives the same sparsity pattern but other values in A, so a circuit that toggles between a few
+ * configurations would refactorize on every toggle. The circuit keeps the factorization of the configuration it solved
+ * last in its own solver and parks the others here; going back to a parked configuration swaps it in and costs a
+ * triangular solve. Entries only stay valid while no other value of A changes, the circuit clears the cache when one does.
+ */
+class FactorizationCache
+{
+public:
+  using Key = std::vector<uint64_t>;  ///< One bit per switch or fuse in the order of the circuit, set when closed
+
+private:
+  std::list<std::pair<Key, LinearSolver>> _entries;  ///< Most recently used first
+  size_t _capacity;                                  ///< Entries beyond which the least recently used is dropped
+  size_t _hits;                                      ///< Lookups answered from the cache
+  size_t _misses;                                    ///< Lookups that had to factorize
+
+public:
+  static constexpr size_t default_capacity = 8;  ///< Parked factorizations, each one as large as the factors of A
+  static constexpr size_t update_limit = 8;      ///< Toggled switches up to which a new configuration is solved as a
+                                                 ///< low-rank update of the factorized one instead of factorized and parked
+
+  /**
+     * @brief Constructor for FactorizationCache.
+     * @param capacity Number of parked factorizations, 0 to disable the cache.
+     */
+  explicit FactorizationCache(size_t capacity = default_capacity);
+
+  /**
+     * @brief Takes the factorization of a configuration out of the cache.
+     * @param key Switch states of the configuration.
+     * @param solver Set to the parked solver on a hit, untouched on a miss.
+     * @return True on a hit.
+     */
+  bool take(const Key &key, LinearSolver &solver);
+
+  /**
+     * @brief Parks a factorization as the most recently used, dropping the least recently used beyond the capacity.
+     * @param key Switch states of the factorized configuration.
+     * @param solver Solver holding the factorization.
+     */
+  void put(const Key &key, LinearSolver &&solver);
+
+  /**
+     * @brief Counts the switches whose state differs between two configurations.
+     * @param a Switch states of one configuration.
+     * @param b Switch states of the other, as many switches.
+     * @return Number of differing bits.
+     */
+  static size_t distance(const Key &a, const Key &b);
+
+  /**
+     * @brief Drops every parked factorization, when a value other than a switch state changed A.
+     */
+  void clear() { _entries.clear(); }
+
+  /**
+     * @brief Sets the number of parked factorizations, dropping the least recently used ones beyond it.
+     * @param capacity New capacity, 0 to disable the cache.
+     */
+  void set_capacity(size_t capacity);
+
+  /**
+     * @brief Gets the number of parked factorizations.
+     */
+  size_t size() const { return _entries.size(); }
+
+  /**
+     * @brief Gets the number of configurations solved from a parked factorization.
+     */
+  size_t hits() const { return _hits; }
+
+  /**
+     * @brief Gets the number of configurations that had to be factorized.
+     */
+  size_t misses() const { return _misses; }
+};
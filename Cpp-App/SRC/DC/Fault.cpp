@@ -0,0 +1,172 @@
+#include "Fault.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Circuit.hpp"
+#include "Parallel.hpp"
+
+FaultSimulator::FaultSimulator(Circuit &circuit)
+    : _circuit(circuit), _solver(circuit.make_workspace()), _solved(false), _threads(0)
+{
+  circuit.set_ground();
+  _stamps = circuit.build_stamps();
+  const auto &elements = circuit.elements();
+  _values.reserve(elements.size());
+  for (auto element : elements) _values.push_back(element->value());
+
+  _matrix_begin.assign(elements.size() + 1, 0);
+  for (auto &stamp : _stamps.matrix) _matrix_begin[stamp.element + 1]++;
+  for (size_t i = 0; i < elements.size(); i++) _matrix_begin[i + 1] += _matrix_begin[i];
+
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(_stamps.matrix.size());
+  for (auto &stamp : _stamps.matrix)
+    triplets.emplace_back(stamp.row, stamp.col, stamp_coefficient(stamp.kind, stamp.sign, _values[stamp.element]));
+  Eigen::SparseMatrix<double> A(_stamps.size, _stamps.size);
+  A.setFromTriplets(triplets.begin(), triplets.end());
+  Eigen::VectorXd Z = Eigen::VectorXd::Zero(_stamps.size);
+  for (auto &stamp : _stamps.sources) Z(stamp.row) += stamp.sign * _values[stamp.element];
+
+  _solved = _solver.factorize(A) && (_solver.solve(Z, _nominal) || (_solver.fall_back() && _solver.solve(Z, _nominal)));
+  if (!_solved)
+    std::cerr << "Fault simulation: nominal circuit has no solution\n";
+}
+
+std::vector<Fault> FaultSimulator::resistor_faults(const Circuit &circuit)
+{
+  std::vector<Fault> faults;
+  for (auto element : circuit.elements())
+    if (element->type() == Type::RESISTOR)
+    {
+      faults.push_back({element->index(), FaultKind::OPEN});
+      faults.push_back({element->index(), FaultKind::SHORT});
+    }
+  return faults;
+}
+
+bool FaultSimulator::rank_one(size_t element, std::vector<std::pair<size_t, double>> &u,
+                              std::vector<std::pair<size_t, double>> &v) const
+{
+  u.clear();
+  v.clear();
+  const MatrixStamp *begin = _stamps.matrix.data() + _matrix_begin[element];
+  const MatrixStamp *end = _stamps.matrix.data() + _matrix_begin[element + 1];
+  if (begin == end)
+    return true;
+
+  //The stamps sum to S = u * v^T: u is the column of S through the first stamp, v its row scaled by 1 / S(r0, c0)
+  auto entry = [&](size_t row, size_t col)
+  {
+    double sum = 0.0;
+    for (const MatrixStamp *stamp = begin; stamp != end; stamp++)
+      if (stamp->row == row && stamp->col == col)
+        sum += stamp->sign;
+    return sum;
+  };
+  const size_t r0 = begin->row;
+  const size_t c0 = begin->col;
+  const double pivot = entry(r0, c0);
+  if (pivot == 0.0)
+  {
+    //Stamps that cancel, both terminals in one node or in rows or columns merged by an op-amp, add nothing to A
+    for (const MatrixStamp *stamp = begin; stamp != end; stamp++)
+      if (entry(stamp->row, stamp->col) != 0.0)
+        return false;
+    return true;
+  }
+  for (const MatrixStamp *stamp = begin; stamp != end; stamp++)
+  {
+    if (std::none_of(u.begin(), u.end(), [&](auto &e) { return e.first == stamp->row; }))
+      u.emplace_back(stamp->row, entry(stamp->row, c0));
+    if (std::none_of(v.begin(), v.end(), [&](auto &e) { return e.first == stamp->col; }))
+      v.emplace_back(stamp->col, entry(r0, stamp->col) / pivot);
+  }
+  return true;
+}
+
+bool FaultSimulator::run(const std::vector<Fault> &faults, const std::vector<std::string> &probes, std::vector<double> &voltages) const
+{
+  const double unsolved = std::numeric_limits<double>::quiet_NaN();
+  voltages.assign(faults.size() * probes.size(), unsolved);
+  if (!_solved)
+    return false;
+
+  //Column of each probe, -1 for the ground and nodes tied to it, which stay at 0 V under any fault
+  std::vector<long> columns;
+  for (auto &name : probes)
+  {
+    if (_circuit.get_node(name) == nullptr)
+    {
+      std::cerr << "Node " << name << " not found\n";
+      return false;
+    }
+    columns.push_back(_circuit.node_unknown(name));
+  }
+
+  //Each worker keeps its own rank-one terms and right hand side, zeroed between faults
+  const size_t threads = _solver.concurrent_solve() ? parallel_threads(faults.size(), _threads) : 1;
+  struct Scratch
+  {
+    std::vector<std::pair<size_t, double>> u, v;
+    Eigen::VectorXd b;
+    Eigen::VectorXd w;
+  };
+  std::vector<Scratch> scratch(threads);
+  for (auto &s : scratch) s.b = Eigen::VectorXd::Zero(_stamps.size);
+
+  auto work = [&](size_t f, size_t worker)
+  {
+    auto &[u, v, b, w] = scratch[worker];
+    const Fault &fault = faults[f];
+    if (fault.element >= _values.size() || _circuit.elements()[fault.element]->type() != Type::RESISTOR ||
+        !rank_one(fault.element, u, v))
+      return;
+
+    //A resistor whose terminals are both tied to the ground or to each other adds nothing to A, and changes nothing
+    double *row = voltages.data() + f * probes.size();
+    if (u.empty())
+    {
+      for (size_t p = 0; p < probes.size(); p++) row[p] = columns[p] < 0 ? 0.0 : _nominal(columns[p]);
+      return;
+    }
+
+    for (auto &[row, coefficient] : u) b(row) = coefficient;
+    bool ok = _solver.solve(b, w);
+    for (auto &[row, coefficient] : u) b(row) = 0.0;
+    if (!ok)
+      return;
+
+    //A' = A + dg * u * v^T gives X' = X - w * dg * (v^T X) / (1 + dg * v^T w) with w = A^-1 u. A short takes the
+    //limit dg -> infinity, X' = X - w * (v^T X) / (v^T w)
+    double vx = 0.0;
+    double vw = 0.0;
+    for (auto &[col, coefficient] : v)
+    {
+      vx += coefficient * _nominal(col);
+      vw += coefficient * w(col);
+    }
+    double scale;
+    if (fault.kind == FaultKind::SHORT)
+    {
+      //v^T w is the resistance seen between the terminals, 0 when they are already tied by a voltage source
+      if (std::abs(vw) <= 1e-12 * w.lpNorm<Eigen::Infinity>())
+        return;
+      scale = vx / vw;
+    }
+    else
+    {
+      //1 + dg * v^T w vanishes when the resistor is the only path to some node
+      double dg = -1.0 / _values[fault.element];
+      double denominator = 1.0 + dg * vw;
+      if (std::abs(denominator) <= 1e-12 * (1.0 + std::abs(dg * vw)))
+        return;
+      scale = dg * vx / denominator;
+    }
+
+    for (size_t p = 0; p < probes.size(); p++) row[p] = columns[p] < 0 ? 0.0 : _nominal(columns[p]) - w(columns[p]) * scale;
+  };
+  parallel_for(faults.size(), threads, work);
+  return true;
+}
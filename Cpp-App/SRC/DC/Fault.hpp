@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../../Include/Eigen/Dense"
+#include "Solver.hpp"
+#include "Stamp.hpp"
+
+class Circuit;
+
+/**
+ * @enum FaultKind
+ * @brief How a faulty resistor fails.
+ */
+enum class FaultKind
+{
+  OPEN,   //R -> infinity, the resistor carries no current
+  SHORT,  //R -> 0, its terminals are at the same voltage
+};
+
+/**
+ * @struct Fault
+ * @brief One failing resistor.
+ */
+struct Fault
+{
+  size_t element;  ///< Element::index() of the resistor
+  FaultKind kind;  ///< Open or short
+};
+
+/**
+ * @class FaultSimulator
+ * @brief Probe voltages of a circuit under many single resistor faults, without rebuilding or refactorizing anything.
+ *
+ * A resistor adds g * u * v^T to A, u and v being the differences of the unit vectors of its terminals' rows and
+ * columns. A fault changes g only, so it is a rank one update of the nominal A, and Sherman-Morrison gives the faulty
+ * solution from the nominal one and a single solve for A^-1 * u against the nominal factorization. A short is the limit
+ * g -> infinity of that update, which is exact instead of an arbitrarily small resistance.
+ */
+class FaultSimulator
+{
+  Circuit &_circuit;                  ///< Circuit simulated, its structure and values must not change meanwhile
+  StampList _stamps;                  ///< Contributions of all elements, emitted element by element
+  std::vector<size_t> _matrix_begin;  ///< First matrix stamp of each element, one more entry than elements
+  std::vector<double> _values;        ///< Nominal value of every element
+  LinearSolver _solver;               ///< Factorization of the nominal A
+  Eigen::VectorXd _nominal;           ///< Nominal solution X
+  bool _solved;                       ///< The nominal system was factorized and solved
+  size_t _threads;                    ///< Threads sharing the faults, 0 for one per core
+
+public:
+  /**
+     * @brief Factorizes and solves the nominal circuit. Sets the ground of the circuit.
+     * @param circuit Circuit to simulate, with the backend and precision settings to factorize with.
+     */
+  explicit FaultSimulator(Circuit &circuit);
+
+  /**
+     * @brief Checks if the nominal circuit has a solution, without one every fault is unsolved.
+     */
+  bool solved() const { return _solved; }
+
+  /**
+     * @brief Sets the number of threads sharing the faults. Iterative backends always run on one.
+     * @param threads Number of threads, 0 for one per core.
+     */
+  void set_threads(size_t threads) { _threads = threads; }
+
+  /**
+     * @brief Lists an open and a short fault for every resistor of a circuit.
+     * @param circuit Circuit.
+     * @return Open then short of each resistor, in element order.
+     */
+  static std::vector<Fault> resistor_faults(const Circuit &circuit);
+
+  /**
+     * @brief Simulates faults one at a time.
+     * @param faults Faults to simulate, each on its own.
+     * @param probes Names of the nodes to report.
+     * @param voltages Set to one row of probe voltages per fault, NaN where the fault leaves the circuit without a
+     * solution (opening the only path to a node, shorting a voltage source) or the element is not a resistor.
+     * @return False if a probe does not exist or the nominal circuit has no solution.
+     */
+  bool run(const std::vector<Fault> &faults, const std::vector<std::string> &probes, std::vector<double> &voltages) const;
+
+private:
+  /**
+     * @brief Splits the conductance stamps of a resistor into the vectors of its rank one contribution.
+     * @param element Element::index() of the resistor.
+     * @param u Set to the (row, coefficient) entries of u.
+     * @param v Set to the (column, coefficient) entries of v.
+     * @return False if the stamps are not of rank one. Both vectors are empty for a resistor that stamps nothing
+     * or whose stamps cancel.
+     */
+  bool rank_one(size_t element, std::vector<std::pair<size_t, double>> &u, std::vector<std::pair<size_t, double>> &v) const;
+};
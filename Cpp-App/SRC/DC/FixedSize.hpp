@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "../../Include/Eigen/Dense"
+#include "Stamp.hpp"
+
+/**
+ * @brief Largest system solved by the fixed size kernels.
+ */
+constexpr size_t fixed_size_limit = 16;
+
+/**
+ * @brief Calls f(std::integral_constant<int, K>) for K = 0, ..., N - 1, as straight line code.
+ */
+template <int... K, class F>
+inline void unroll(std::integer_sequence<int, K...>, F &&f)
+{
+  (f(std::integral_constant<int, K>{}), ...);
+}
+
+/**
+ * @brief Solves A x = b in place with LU and partial pivoting. The elimination is unrolled over k and every inner loop
+ * has a trip count known at compile time, so the compiler unrolls and vectorizes it; nothing leaves the stack. Works on
+ * the raw column major storage, which also keeps Eigen's index assertions out of the inner loops.
+ * @param A Matrix, overwritten by its factors.
+ * @param b Right hand side, overwritten by x.
+ * @return False if a pivot is negligible next to the largest entry of A.
+ */
+template <int N>
+bool fixed_size_lu_solve(Eigen::Matrix<double, N, N> &A, Eigen::Matrix<double, N, 1> &b)
+{
+  double *a = A.data();
+  double *x = b.data();
+  const double tolerance = N * std::numeric_limits<double>::epsilon() * A.cwiseAbs().maxCoeff();
+  bool regular = true;
+  unroll(std::make_integer_sequence<int, N>{}, [&](auto step)
+  {
+    constexpr int k = decltype(step)::value;
+    double *column = a + k * N;
+    int p = k;
+    for (int i = k + 1; i < N; i++)
+      p = std::abs(column[i]) > std::abs(column[p]) ? i : p;
+    if (std::abs(column[p]) <= tolerance)
+      regular = false;
+    if (!regular)
+      return;
+    if (p != k)
+    {
+      for (int j = 0; j < N; j++) std::swap(a[k + j * N], a[p + j * N]);
+      std::swap(x[k], x[p]);
+    }
+    const double inverse_pivot = 1.0 / column[k];
+    for (int i = k + 1; i < N; i++) column[i] *= inverse_pivot;
+    for (int j = k + 1; j < N; j++)
+    {
+      const double pivot_row = a[k + j * N];
+      for (int i = k + 1; i < N; i++) a[i + j * N] -= column[i] * pivot_row;
+    }
+    for (int i = k + 1; i < N; i++) x[i] -= column[i] * x[k];
+  });
+  if (!regular)
+    return false;
+
+  for (int j = N - 1; j >= 0; j--)
+  {
+    x[j] /= a[j + j * N];
+    for (int i = 0; i < j; i++) x[i] -= a[i + j * N] * x[j];
+  }
+  return true;
+}
+
+/**
+ * @brief Stamps the circuit straight into an N x N system on the stack and solves it.
+ * @param stamps Contributions of all elements, stamps.size must be N.
+ * @param values Value of every element, indexed like Circuit::elements().
+ * @param x Set to the N unknowns.
+ * @return False if the system is singular.
+ */
+template <int N>
+bool fixed_size_solve(const StampList &stamps, const double *values, double *x)
+{
+  Eigen::Matrix<double, N, N> A = Eigen::Matrix<double, N, N>::Zero();
+  Eigen::Matrix<double, N, 1> b = Eigen::Matrix<double, N, 1>::Zero();
+  for (auto &stamp : stamps.matrix) A.data()[stamp.row + stamp.col * N] += stamp_coefficient(stamp.kind, stamp.sign, values[stamp.element]);
+  for (auto &stamp : stamps.sources) b.data()[stamp.row] += stamp.sign * values[stamp.element];
+  if (!fixed_size_lu_solve<N>(A, b))
+    return false;
+  Eigen::Map<Eigen::Matrix<double, N, 1>> result(x);
+  result = b;
+  return true;
+}
+
+using FixedSizeKernel = bool (*)(const StampList &, const double *, double *);
+
+template <size_t... I>
+constexpr std::array<FixedSizeKernel, sizeof...(I)> fixed_size_kernels(std::index_sequence<I...>)
+{
+  return {&fixed_size_solve<int(I) + 1>...};
+}
+
+/**
+ * @brief Solves a system of at most fixed_size_limit unknowns with the kernel instantiated for its size. Nothing is
+ * allocated on the heap.
+ * @param stamps Contributions of all elements.
+ * @param values Value of every element, indexed like Circuit::elements().
+ * @param x Set to the unknowns, room for stamps.size values.
+ * @return False if the system is too large or singular.
+ */
+inline bool fixed_size_solve(const StampList &stamps, const double *values, double *x)
+{
+  static constexpr auto kernels = fixed_size_kernels(std::make_index_sequence<fixed_size_limit>{});
+  return stamps.size >= 1 && stamps.size <= fixed_size_limit && kernels[stamps.size - 1](stamps, values, x);
+}
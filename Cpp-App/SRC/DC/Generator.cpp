@@ -0,0 +1,177 @@
+#include "Generator.hpp"
+
+#include <charconv>
+#include <system_error>
+
+//Appends a number to a name being formatted
+static void append(std::string &buffer, long value)
+{
+  char digits[24];
+  buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+//Node of a name, created if the circuit has none yet
+static Node *find_or_add(Circuit &circuit, const std::string &name)
+{
+  Node *node = circuit.get_node(name);
+  if (node == nullptr)
+  {
+    circuit.add_node(name);
+    node = circuit.nodes().back();
+  }
+  return node;
+}
+
+//A template string split at its placeholders: literal text, or the instance index plus an offset
+struct Piece
+{
+  std::string text;  ///< Literal text, empty for a placeholder
+  long offset;       ///< Offset added to the index by a placeholder
+};
+
+static std::vector<Piece> split(const std::string &pattern)
+{
+  std::vector<Piece> pieces;
+  std::string text;
+  for (size_t i = 0; i < pattern.size(); i++)
+  {
+    //{i}, {i+k} or {i-k}, anything else is literal
+    size_t close = pattern.compare(i, 2, "{i") == 0 ? pattern.find('}', i) : std::string::npos;
+    long offset = 0;
+    if (close != std::string::npos && close > i + 2)
+    {
+      const char *begin = pattern.data() + i + 2 + (pattern[i + 2] == '+' ? 1 : 0);
+      auto [end, error] = std::from_chars(begin, pattern.data() + close, offset);
+      if (error != std::errc() || end != pattern.data() + close || (pattern[i + 2] != '+' && pattern[i + 2] != '-'))
+        close = std::string::npos;
+    }
+    if (close == std::string::npos)
+    {
+      text += pattern[i];
+      continue;
+    }
+    if (!text.empty())
+      pieces.push_back({std::move(text), 0});
+    text.clear();
+    pieces.push_back({"", offset});
+    i = close;
+  }
+  if (!text.empty())
+    pieces.push_back({std::move(text), 0});
+  return pieces;
+}
+
+static void expand(std::string &buffer, const std::vector<Piece> &pieces, size_t index)
+{
+  buffer.clear();
+  for (const Piece &piece : pieces)
+    if (piece.text.empty())
+      append(buffer, long(index) + piece.offset);
+    else
+      buffer += piece.text;
+}
+
+bool NetlistGenerator::grid(Circuit &circuit, const std::string &name, size_t rows, size_t columns, double horizontal, double vertical)
+{
+  circuit.reserve(circuit.nodes().size() + rows * columns, circuit.elements().size() + 2 * rows * columns);
+  std::string buffer;
+  auto format = [&](const char *kind, size_t row, size_t column) -> const std::string &
+  {
+    buffer = name;
+    buffer += kind;
+    append(buffer, long(row));
+    buffer += '_';
+    append(buffer, long(column));
+    return buffer;
+  };
+
+  std::vector<Node *> nodes(rows * columns);
+  for (size_t r = 0; r < rows; r++)
+    for (size_t c = 0; c < columns; c++) nodes[r * columns + c] = find_or_add(circuit, format("_", r, c));
+  for (size_t r = 0; r < rows; r++)
+    for (size_t c = 0; c < columns; c++)
+    {
+      Node *node = nodes[r * columns + c];
+      if (c + 1 < columns && !circuit.add_resistor(format("_h_", r, c), node, nodes[r * columns + c + 1], horizontal))
+        return false;
+      if (r + 1 < rows && !circuit.add_resistor(format("_v_", r, c), node, nodes[(r + 1) * columns + c], vertical))
+        return false;
+    }
+  return true;
+}
+
+bool NetlistGenerator::ladder(Circuit &circuit, const std::string &name, size_t bits, double resistance, const std::string &ground)
+{
+  if (bits == 0)
+    return true;
+  circuit.reserve(circuit.nodes().size() + 2 * bits + 1, circuit.elements().size() + 2 * bits);
+  std::string buffer;
+  auto format = [&](const char *kind, size_t bit) -> const std::string &
+  {
+    buffer = name;
+    buffer += kind;
+    append(buffer, long(bit));
+    return buffer;
+  };
+
+  Node *previous = nullptr;
+  for (size_t i = 0; i < bits; i++)
+  {
+    Node *node = find_or_add(circuit, format("_", i));
+    Node *input = find_or_add(circuit, format("_b", i));
+    if (!circuit.add_resistor(format("_2R_", i), node, input, 2 * resistance))
+      return false;
+    if (previous == nullptr)
+    {
+      if (!circuit.add_resistor(name + "_T", node, find_or_add(circuit, ground), 2 * resistance))
+        return false;
+    }
+    else if (!circuit.add_resistor(format("_R_", i - 1), previous, node, resistance))
+      return false;
+    previous = node;
+  }
+  return true;
+}
+
+bool NetlistGenerator::array(Circuit &circuit, size_t count, const std::vector<Template> &elements)
+{
+  //Placeholders are found once, each instance only concatenates
+  std::vector<std::vector<Piece>> names;
+  std::vector<std::vector<Piece>> positives;
+  std::vector<std::vector<Piece>> negatives;
+  for (const Template &element : elements)
+  {
+    names.push_back(split(element.name));
+    positives.push_back(split(element.pos));
+    negatives.push_back(split(element.neg));
+  }
+  circuit.reserve(circuit.nodes().size() + count * elements.size(), circuit.elements().size() + count * elements.size());
+
+  std::string name;
+  std::string pos;
+  std::string neg;
+  for (size_t i = 0; i < count; i++)
+    for (size_t e = 0; e < elements.size(); e++)
+    {
+      const Template &element = elements[e];
+      expand(name, names[e], i);
+      expand(pos, positives[e], i);
+      expand(neg, negatives[e], i);
+      Node *pos_node = find_or_add(circuit, pos);
+      Node *neg_node = find_or_add(circuit, neg);
+      double value = element.value + double(i) * element.step;
+      //Two-terminal kinds are added straight by node, the others look their nodes up again by name
+      bool added;
+      if (element.type == "RESISTOR")
+        added = circuit.add_resistor(name, pos_node, neg_node, value);
+      else if (element.type == "VOLTAGE_SUPPLY")
+        added = circuit.add_v_source(name, pos_node, neg_node, value);
+      else if (element.type == "CURRENT_SUPPLY")
+        added = circuit.add_c_source(name, pos_node, neg_node, value);
+      else
+        added = circuit.add_element(element.type, name, pos, neg, value);
+      if (!added)
+        return false;
+    }
+  return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Circuit.hpp"
+
+/**
+ * @class NetlistGenerator
+ * @brief Expands the parametric constructs of a JSON netlist (resistor meshes, R-2R ladders and arrays of a template)
+ * straight into a circuit, so a mechanically repeated structure costs one line of JSON instead of one object per
+ * element.
+ *
+ * Nodes are created on first use and reused if the netlist already declares them, so the generated structure is wired
+ * to the rest of the circuit by name. Names are formatted into one reused buffer, and meshes and ladders add their
+ * resistors between the nodes they hold instead of looking them up by name.
+ */
+class NetlistGenerator
+{
+public:
+  /**
+     * @brief One element of an array template.
+     */
+  struct Template
+  {
+    std::string type;  ///< Element type, as in a netlist: RESISTOR, VOLTAGE_SUPPLY, ...
+    std::string name;  ///< Name, in which {i} stands for the index of the instance
+    std::string pos;   ///< Positive node, {i}, {i+k} and {i-k} stand for the index of the instance and its neighbours
+    std::string neg;   ///< Negative node, placeholders as in pos
+    double value;      ///< Value in the first instance
+    double step;       ///< Added to the value in each following instance
+  };
+
+  /**
+     * @brief Adds a rows x columns resistor mesh. Node name_r_c is joined to name_r_(c+1) by the resistor name_h_r_c
+     * and to name_(r+1)_c by name_v_r_c.
+     * @param circuit Circuit to add to.
+     * @param name Name of the mesh, prefixing its nodes and resistors.
+     * @param rows Number of rows of nodes.
+     * @param columns Number of columns of nodes.
+     * @param horizontal Resistance between neighbours on a row, the pitch along it.
+     * @param vertical Resistance between neighbours on a column.
+     * @return False if a resistor name is taken.
+     */
+  static bool grid(Circuit &circuit, const std::string &name, size_t rows, size_t columns, double horizontal, double vertical);
+
+  /**
+     * @brief Adds an R-2R ladder of bits bits. Node name_i, i = 0 for the least significant bit, is joined to the input
+     * node name_bi by the 2R leg name_2R_i and to name_(i+1) by the resistor name_R_i; name_0 is terminated to the ground
+     * node by name_T (2R), and name_(bits-1) is the output.
+     * @param circuit Circuit to add to.
+     * @param name Name of the ladder, prefixing its nodes and resistors.
+     * @param bits Number of bits, at least one.
+     * @param resistance Resistance R.
+     * @param ground Name of the node the termination returns to, created if missing.
+     * @return False if a resistor name is taken.
+     */
+  static bool ladder(Circuit &circuit, const std::string &name, size_t bits, double resistance, const std::string &ground);
+
+  /**
+     * @brief Adds count instances of a template, substituting the index of each instance for its placeholders.
+     * @param circuit Circuit to add to.
+     * @param count Number of instances.
+     * @param elements Elements of one instance.
+     * @return False if an element cannot be added, for instance a name without {i} repeating.
+     */
+  static bool array(Circuit &circuit, size_t count, const std::vector<Template> &elements);
+};
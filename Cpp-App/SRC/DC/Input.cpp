@@ -0,0 +1,149 @@
+#include "Input.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <zlib.h>
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define CIRCUIT_HAS_ZSTD 1
+#endif
+
+//Inflates a gzip file one buffer at a time
+class GzipBuffer : public std::streambuf
+{
+  gzFile _file;             ///< Open file, nullptr if it could not be opened
+  std::vector<char> _data;  ///< Inflated bytes the parser reads from
+
+public:
+  explicit GzipBuffer(const std::string &path) : _file(gzopen(path.c_str(), "rb")), _data(InputFile::buffer_size)
+  {
+    if (_file != nullptr)
+      gzbuffer(_file, InputFile::buffer_size);
+  }
+
+  ~GzipBuffer() override
+  {
+    if (_file != nullptr)
+      gzclose(_file);
+  }
+
+  bool is_open() const { return _file != nullptr; }
+
+protected:
+  //A truncated or corrupt file ends the stream early, the parser reports it
+  int_type underflow() override
+  {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    int count = _file != nullptr ? gzread(_file, _data.data(), unsigned(_data.size())) : 0;
+    if (count <= 0)
+      return traits_type::eof();
+    setg(_data.data(), _data.data(), _data.data() + count);
+    return traits_type::to_int_type(*gptr());
+  }
+};
+
+#ifdef CIRCUIT_HAS_ZSTD
+//Decompresses a zstd file one buffer at a time
+class ZstdBuffer : public std::streambuf
+{
+  std::ifstream _file;     ///< Compressed file
+  ZSTD_DStream *_stream;   ///< Decompression state
+  std::vector<char> _in;   ///< Compressed bytes read from the file
+  std::vector<char> _out;  ///< Decompressed bytes the parser reads from
+  ZSTD_inBuffer _input;    ///< Part of _in not decompressed yet
+  bool _end;               ///< The whole file has been read into _in
+
+public:
+  explicit ZstdBuffer(const std::string &path)
+      : _file(path, std::ios::binary), _stream(ZSTD_createDStream()), _in(ZSTD_DStreamInSize()),
+        _out(InputFile::buffer_size), _input{_in.data(), 0, 0}, _end(false)
+  {
+    if (_stream != nullptr)
+      ZSTD_initDStream(_stream);
+  }
+
+  ~ZstdBuffer() override { ZSTD_freeDStream(_stream); }
+
+  bool is_open() const { return _file.is_open() && _stream != nullptr; }
+
+protected:
+  int_type underflow() override
+  {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    ZSTD_outBuffer output{_out.data(), _out.size(), 0};
+    while (output.pos == 0)
+    {
+      if (_input.pos == _input.size && !_end)
+      {
+        _file.read(_in.data(), _in.size());
+        _input.size = size_t(_file.gcount());
+        _input.pos = 0;
+        _end = _input.size < _in.size();
+      }
+      //With no input left a call still flushes what the decoder holds back
+      if (ZSTD_isError(ZSTD_decompressStream(_stream, &output, &_input)))
+        return traits_type::eof();
+      if (output.pos == 0 && _input.pos == _input.size && _end)
+        return traits_type::eof();
+    }
+    setg(_out.data(), _out.data(), _out.data() + output.pos);
+    return traits_type::to_int_type(*gptr());
+  }
+};
+#endif
+
+InputFile::InputFile(const std::string &path) : std::istream(nullptr)
+{
+  unsigned char magic[4] = {0, 0, 0, 0};
+  {
+    std::ifstream probe(path, std::ios::binary);
+    probe.read(reinterpret_cast<char *>(magic), sizeof(magic));
+  }
+
+  bool open = false;
+  if (magic[0] == 0x1f && magic[1] == 0x8b)
+  {
+    auto buffer = std::make_unique<GzipBuffer>(path);
+    open = buffer->is_open();
+    _buffer = std::move(buffer);
+  }
+  else if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+  {
+#ifdef CIRCUIT_HAS_ZSTD
+    auto buffer = std::make_unique<ZstdBuffer>(path);
+    open = buffer->is_open();
+    _buffer = std::move(buffer);
+#else
+    std::cerr << "Error: " << path << " is zstd compressed, which this build cannot read\n";
+#endif
+  }
+  else
+  {
+    auto buffer = std::make_unique<std::filebuf>();
+    open = buffer->open(path, std::ios::in | std::ios::binary) != nullptr;
+    _buffer = std::move(buffer);
+  }
+  rdbuf(_buffer.get());
+  if (!open)
+    setstate(std::ios::failbit);
+}
+
+bool InputFile::is_netlist(const std::string &path)
+{
+  auto ends_with = [&](const std::string &suffix)
+  { return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0; };
+  return ends_with(".json") || ends_with(".json.gz") || ends_with(".json.zst");
+}
+
+bool InputFile::has_zstd()
+{
+#ifdef CIRCUIT_HAS_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+/**
+ * @class InputFile
+ * @brief Input stream over a netlist file that decompresses gzip and, when built with zstd, zstd files on the fly.
+ *
+ * The format is told by the magic bytes, not the name, and anything else is read as is. A compressed file is inflated
+ * one buffer at a time as the parser pulls characters, so the decompressed netlist never exists in full, neither on
+ * disk nor in memory. A missing or unreadable file leaves the stream failed, like std::ifstream.
+ */
+class InputFile : public std::istream
+{
+  std::unique_ptr<std::streambuf> _buffer;  ///< Buffer reading the file, plain or decompressing
+
+public:
+  static constexpr size_t buffer_size = size_t(1) << 18;  ///< Bytes read from the file and inflated per refill
+
+  /**
+     * @brief Opens a file for reading.
+     * @param path Path of the file.
+     */
+  explicit InputFile(const std::string &path);
+
+  /**
+     * @brief Checks if a name is that of a netlist the loaders read: .json, optionally followed by .gz or .zst.
+     * @param path Path or name of the file.
+     */
+  static bool is_netlist(const std::string &path);
+
+  /**
+     * @brief Checks if zstd files can be read, which depends on zstd being available at build time.
+     */
+  static bool has_zstd();
+};
@@ -1,5 +1,7 @@
 #include "Node.hpp"
 
+#include <algorithm>
+
 // Constructor definition
 Node::Node(size_t id, std::string name) : _id(id), _name(std::move(name)), _num_elements(0), _is_ground(false), _voltage(0.0) {}
 
@@ -13,20 +15,33 @@ void Node::add_element(Element *element)
   _num_elements++;
 }
 
+// Function to remove one connection of an element from the node
+void Node::remove_element(Element *element)
+{
+  auto it = std::find(_elements.begin(), _elements.end(), element);
+  if (it == _elements.end())
+    return;
+  _elements.erase(it);
+  _num_elements--;
+}
+
 // Getter for the number of elements
 size_t Node::num_elements() const { return _num_elements; }
 
 // Getter for the node ID
 size_t Node::id() const { return _id; }
 
+// Setter for the node ID
+void Node::set_id(size_t id) { _id = id; }
+
 // Getter for the node name
 std::string Node::name() const { return _name; }
 
 // Getter for the elements connected to the node
 std::vector<Element *> Node::elements() const { return _elements; }
 
-// Function to set the node as ground
-void Node::set_ground() { _is_ground = true; }
+// Function to set or clear the node as ground
+void Node::set_ground(bool ground) { _is_ground = ground; }
 
 // Function to check if the node is ground
 bool Node::is_ground() const { return _is_ground; }
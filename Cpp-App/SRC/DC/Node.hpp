@@ -38,6 +38,12 @@ public:
      */
   void add_element(Element *element);
 
+  /**
+     * @brief Removes an element from the node, when it is deleted or moved to another node.
+     * @param element Pointer to the element to be removed.
+     */
+  void remove_element(Element *element);
+
   /**
      * @brief Gets the number of elements connected to the node.
      * @return Number of elements connected to the node.
@@ -50,6 +56,12 @@ public:
      */
   size_t id() const;
 
+  /**
+     * @brief Sets the ID of the node, when the circuit renumbers its nodes after dropping one.
+     * @param id New ID.
+     */
+  void set_id(size_t id);
+
   /**
      * @brief Gets the name of the node.
      * @return Name of the node.
@@ -63,9 +75,10 @@ public:
   std::vector<Element *> elements() const;
 
   /**
-     * @brief Sets the node as ground.
+     * @brief Sets or clears the node as ground.
+     * @param ground False when the ground moves to another node.
      */
-  void set_ground();
+  void set_ground(bool ground = true);
 
   /**
      * @brief Checks if the node is ground.
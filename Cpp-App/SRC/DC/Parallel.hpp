@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Number of threads parallel_for runs on.
+ * @param count Number of items.
+ * @param threads Requested threads, 0 for one per hardware thread.
+ * @return Threads to use, at least 1 and at most one per item.
+ */
+inline size_t parallel_threads(size_t count, size_t threads)
+{
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  return std::min(threads, std::max<size_t>(count, 1));
+}
+
+/**
+ * @brief Calls body(i, worker) for every i < count on parallel_threads(count, threads) threads, the calling one
+ * included. Items differ in cost, so each worker pulls the next index instead of owning a fixed slice. worker is below
+ * parallel_threads(count, threads) and tells a body which per-thread state to use.
+ * @param count Number of items.
+ * @param threads Requested threads, 0 for one per hardware thread.
+ * @param body Work on one item, called concurrently with different items.
+ */
+template <class Body>
+void parallel_for(size_t count, size_t threads, Body &&body)
+{
+  threads = parallel_threads(count, threads);
+  std::atomic<size_t> next(0);
+  auto work = [&](size_t worker)
+  {
+    for (size_t i = next++; i < count; i = next++) body(i, worker);
+  };
+
+  std::vector<std::thread> pool;
+  for (size_t worker = 1; worker < threads; worker++) pool.emplace_back(work, worker);
+  work(0);
+  for (auto &thread : pool) thread.join();
+}
@@ -0,0 +1,214 @@
+//GCC flags Eigen's eigenvalue solvers with false maybe-uninitialized warnings, which are reported at the header lines,
+//so the headers are parsed here first with the warning off
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include "../../Include/Eigen/Dense"
+#pragma GCC diagnostic pop
+
+#include "Pole.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "Circuit.hpp"
+
+using SparseMatrix = Eigen::SparseMatrix<double>;
+
+//Assemble the stamps of one side of the pencil at the current element values
+static SparseMatrix assemble(const std::vector<MatrixStamp> &stamps, const Circuit &circuit, size_t size)
+{
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(stamps.size());
+  for (auto &stamp : stamps)
+    triplets.emplace_back(stamp.row, stamp.col, stamp_coefficient(stamp.kind, stamp.sign, circuit.elements()[stamp.element]->value()));
+  SparseMatrix M(size, size);
+  M.setFromTriplets(triplets.begin(), triplets.end());
+  return M;
+}
+
+//Finite eigenvalues of A * v = s * B * v. Both sides are scaled to unit norm first, so a beta that is zero up to
+//rounding marks an infinite eigenvalue whatever the units of the circuit
+static std::vector<std::complex<double>> finite_eigenvalues(const Eigen::MatrixXd &A, const Eigen::MatrixXd &B)
+{
+  std::vector<std::complex<double>> values;
+  double a_norm = A.norm();
+  double b_norm = B.norm();
+  if (a_norm == 0.0 || b_norm == 0.0)
+    return values;
+
+  Eigen::GeneralizedEigenSolver<Eigen::MatrixXd> solver(A / a_norm, B / b_norm, false);
+  if (solver.info() != Eigen::Success)
+    return values;
+  const double threshold = 1e3 * std::numeric_limits<double>::epsilon() * A.rows();
+  for (Eigen::Index i = 0; i < A.rows(); i++)
+  {
+    std::complex<double> alpha = solver.alphas()(i);
+    double beta = solver.betas()(i);
+    if (std::abs(beta) > threshold * std::max(std::abs(alpha), std::abs(beta)))
+      values.push_back(alpha / beta * (a_norm / b_norm));
+  }
+  std::sort(values.begin(), values.end(), [](auto a, auto b) { return std::abs(a) < std::abs(b); });
+  return values;
+}
+
+PoleAnalysis::PoleAnalysis(Circuit &circuit)
+    : _circuit(circuit), _solver(circuit.make_workspace()), _shift(0.0), _factorized(false)
+{
+  circuit.set_ground();
+  _stamps = circuit.build_stamps();
+  _G = assemble(_stamps.matrix, circuit, _stamps.size);
+  _C = assemble(_stamps.reactive, circuit, _stamps.size);
+}
+
+std::vector<std::complex<double>> PoleAnalysis::all_poles() const
+{
+  //(G + s * C) v = 0 is G v = s * (-C) v
+  return finite_eigenvalues(Eigen::MatrixXd(_G), -Eigen::MatrixXd(_C));
+}
+
+std::vector<std::complex<double>> PoleAnalysis::dominant_poles(size_t count, double shift)
+{
+  std::vector<std::complex<double>> poles;
+  const size_t n = _stamps.size;
+  if (count == 0 || n == 0)
+    return poles;
+
+  if (!_factorized || shift != _shift)
+  {
+    SparseMatrix M = _G + shift * _C;
+    _shift = shift;
+    _factorized = _solver.factorize(M);
+  }
+  if (!_factorized)
+  {
+    std::cerr << "Pole analysis: G + " << shift << " * C is singular, try another shift\n";
+    return poles;
+  }
+
+  //y = -(G + shift * C)^-1 * C * x, one sparse product and one solve against the factorization
+  Eigen::VectorXd scratch;
+  auto apply = [&](const Eigen::VectorXd &x, Eigen::VectorXd &y)
+  {
+    scratch = -(_C * x);
+    return _solver.solve(scratch, y) || (_solver.fall_back() && _solver.solve(scratch, y));
+  };
+
+  //Starting from the image of a random vector keeps the start out of the null space of C (the infinite poles)
+  std::mt19937 generator(1);
+  std::normal_distribution<double> normal;
+  Eigen::VectorXd start(n);
+  for (size_t i = 0; i < n; i++) start(i) = normal(generator);
+  if (!apply(Eigen::VectorXd(start), start) || start.norm() == 0.0)
+    return poles;
+
+  const size_t m = std::min(n, std::max(2 * count + 20, 3 * count));
+  Eigen::MatrixXd V(n, m + 1);
+  Eigen::MatrixXd H(m + 1, m);
+  Eigen::VectorXcd theta;
+  Eigen::MatrixXcd Y;
+  std::vector<Eigen::Index> order;
+  size_t steps = 0;
+  for (int restart = 0; restart <= max_restarts; restart++)
+  {
+    //Arnoldi with classical Gram-Schmidt done twice, which keeps V orthogonal to working precision
+    H.setZero();
+    V.col(0) = start / start.norm();
+    steps = m;
+    for (size_t j = 0; j < m; j++)
+    {
+      Eigen::VectorXd w;
+      if (!apply(V.col(j), w))
+        return poles;
+      for (int pass = 0; pass < 2; pass++)
+      {
+        Eigen::VectorXd h = V.leftCols(j + 1).transpose() * w;
+        w -= V.leftCols(j + 1) * h;
+        H.col(j).head(j + 1) += h;
+      }
+      H(j + 1, j) = w.norm();
+      //An invariant subspace: its Ritz values are exact
+      if (H(j + 1, j) <= tolerance * H.col(j).head(j + 1).norm())
+      {
+        steps = j + 1;
+        break;
+      }
+      V.col(j + 1) = w / H(j + 1, j);
+    }
+
+    Eigen::EigenSolver<Eigen::MatrixXd> ritz(H.topLeftCorner(steps, steps));
+    theta = ritz.eigenvalues();
+    Y = ritz.eigenvectors();
+    order.resize(steps);
+    for (size_t i = 0; i < steps; i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](auto a, auto b) { return std::abs(theta(a)) > std::abs(theta(b)); });
+    order.resize(std::min(count, steps));
+
+    //The residual of a Ritz pair is |h(m + 1, m)| times the last entry of its eigenvector
+    bool converged = steps < m;
+    if (!converged)
+    {
+      converged = true;
+      for (auto i : order) converged = converged && std::abs(H(steps, steps - 1) * Y(steps - 1, i)) <= tolerance * std::abs(theta(i));
+    }
+    if (converged || restart == max_restarts)
+      break;
+
+    //Explicit restart from the wanted Ritz vectors, both halves of a complex pair through the real and imaginary parts
+    Eigen::VectorXcd combined = V.leftCols(steps) * (Y(Eigen::all, order).rowwise().sum());
+    start = combined.real() + combined.imag();
+  }
+
+  for (auto i : order)
+    if (theta(i) != 0.0)
+      poles.push_back(shift + 1.0 / theta(i));
+  std::sort(poles.begin(), poles.end(), [&](auto a, auto b) { return std::abs(a - shift) < std::abs(b - shift); });
+  return poles;
+}
+
+std::vector<std::complex<double>> PoleAnalysis::poles(size_t count)
+{
+  if (_stamps.size > dense_limit)
+    return dominant_poles(count);
+  std::vector<std::complex<double>> poles = all_poles();
+  if (poles.size() > count)
+    poles.resize(count);
+  return poles;
+}
+
+std::vector<std::complex<double>> PoleAnalysis::zeros(const std::string &input, const std::string &output) const
+{
+  Element *source = _circuit.get_element(input);
+  if (source == nullptr || (source->type() != Type::VOLTAGE_SUPPLY && source->type() != Type::CURRENT_SOURCE))
+  {
+    std::cerr << "Pole analysis: " << input << " is not an independent source\n";
+    return {};
+  }
+  if (_circuit.get_node(output) == nullptr)
+  {
+    std::cerr << "Node " << output << " not found\n";
+    return {};
+  }
+
+  //det [G + s * C, b; c^T, 0] = 0, with b where the source enters Z and c picking the output voltage
+  const size_t n = _stamps.size;
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(n + 1, n + 1);
+  Eigen::MatrixXd B = Eigen::MatrixXd::Zero(n + 1, n + 1);
+  A.topLeftCorner(n, n) = _G;
+  B.topLeftCorner(n, n) = -Eigen::MatrixXd(_C);
+  for (auto &stamp : _stamps.sources)
+    if (stamp.element == source->index())
+      A(stamp.row, n) += stamp.sign;
+  long column = _circuit.node_unknown(output);
+  if (column < 0)
+    return {};
+  A(n, column) = 1.0;
+  return finite_eigenvalues(A, B);
+}
+
+bool PoleAnalysis::stable(const std::vector<std::complex<double>> &poles)
+{
+  return std::all_of(poles.begin(), poles.end(), [](auto pole) { return pole.real() < 0.0; });
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../../Include/Eigen/Dense"
+#include "../../Include/Eigen/SparseCore"
+#include "Solver.hpp"
+#include "Stamp.hpp"
+
+class Circuit;
+
+/**
+ * @class PoleAnalysis
+ * @brief Natural frequencies of a circuit with capacitors and inductors: the values of s for which the MNA pencil
+ * G + s * C is singular.
+ *
+ * G is the DC matrix A and C collects the capacitances and inductances. C is singular whenever some node has no
+ * capacitance or the circuit has sources, so the pencil also has infinite eigenvalues, which are dropped. Small systems
+ * get every pole from the dense QZ algorithm. Large ones get the few poles closest to a shift from Arnoldi iterations on
+ * -(G + shift * C)^-1 * C, whose largest eigenvalues mu are the poles s = shift + 1 / mu nearest the shift; G + shift * C
+ * is factorized once and every iteration reuses the factorization.
+ */
+class PoleAnalysis
+{
+  Circuit &_circuit;              ///< Circuit analyzed, its structure and values must not change meanwhile
+  StampList _stamps;              ///< Contributions of all elements, G from matrix and C from reactive
+  Eigen::SparseMatrix<double> _G; ///< Conductance part of the pencil
+  Eigen::SparseMatrix<double> _C; ///< Capacitance and inductance part of the pencil
+  LinearSolver _solver;           ///< Factorization of G + _shift * C
+  double _shift;                  ///< Shift of the current factorization
+  bool _factorized;               ///< _solver holds a factorization of G + _shift * C
+
+public:
+  static constexpr size_t dense_limit = 200;     ///< Systems up to this size get all their poles from dense QZ
+  static constexpr int max_restarts = 50;        ///< Arnoldi restarts before the unconverged poles are returned anyway
+  static constexpr double tolerance = 1e-10;     ///< Relative residual at which an Arnoldi pole counts as converged
+
+  /**
+     * @brief Forms G and C. Sets the ground of the circuit.
+     * @param circuit Circuit to analyze, with the backend settings to factorize with.
+     */
+  explicit PoleAnalysis(Circuit &circuit);
+
+  /**
+     * @brief Gets the number of unknowns, the size of the pencil.
+     */
+  size_t size() const { return _stamps.size; }
+
+  /**
+     * @brief Computes every finite pole with the dense QZ algorithm, O(size^3).
+     * @return Poles in rad/s sorted by magnitude, empty if the pencil is singular for every s.
+     */
+  std::vector<std::complex<double>> all_poles() const;
+
+  /**
+     * @brief Computes the poles nearest a shift with shift-invert Arnoldi.
+     * @param count Number of poles wanted, a complex pair counts twice.
+     * @param shift Real shift in rad/s, 0 for the slowest (dominant) poles. G + shift * C must be regular.
+     * @return Up to count poles sorted by distance to the shift, empty if G + shift * C is singular.
+     */
+  std::vector<std::complex<double>> dominant_poles(size_t count, double shift = 0.0);
+
+  /**
+     * @brief Computes the slowest poles with the method that fits the size of the system.
+     * @param count Number of poles wanted.
+     * @return Up to count poles sorted by magnitude.
+     */
+  std::vector<std::complex<double>> poles(size_t count);
+
+  /**
+     * @brief Computes the finite zeros of the transfer function from an independent source to a node voltage, as the
+     * eigenvalues of the pencil bordered by the input and output vectors. Dense, O(size^3).
+     * @param input Name of a voltage or current source.
+     * @param output Name of the output node.
+     * @return Zeros in rad/s sorted by magnitude, empty if the names are wrong.
+     */
+  std::vector<std::complex<double>> zeros(const std::string &input, const std::string &output) const;
+
+  /**
+     * @brief Checks if every pole is in the open left half plane.
+     * @param poles Poles to check.
+     * @return True if the circuit is stable.
+     */
+  static bool stable(const std::vector<std::complex<double>> &poles);
+};
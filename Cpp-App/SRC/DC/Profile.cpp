@@ -0,0 +1,78 @@
+#include "Profile.hpp"
+
+#include <sstream>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+const char *phase_name(Phase phase)
+{
+  switch (phase)
+  {
+    case Phase::PARSE: return "parse";
+    case Phase::GROUND_SELECTION: return "ground_selection";
+    case Phase::ASSEMBLY: return "assembly";
+    case Phase::FACTORIZATION: return "factorization";
+    case Phase::SOLVE: return "solve";
+    case Phase::WRITE_BACK: return "write_back";
+    default: return "unknown";
+  }
+}
+
+// Eigen allocates through std::malloc rather than operator new, so we ask the allocator itself instead of
+// counting in a replaced operator new
+size_t heap_bytes_in_use()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+double SolveProfile::total_ms() const
+{
+  double total = 0;
+  for (auto &phase : phases) total += phase.wall_ms;
+  return total;
+}
+
+std::string SolveProfile::to_json() const
+{
+  std::ostringstream out;
+  out << "{";
+  for (size_t i = 0; i < phases.size(); i++)
+  {
+    const PhaseStats &stats = phases[i];
+    if (i != 0)
+      out << ", ";
+    out << "\"" << phase_name(static_cast<Phase>(i)) << "\": {\"wall_ms\": " << stats.wall_ms
+        << ", \"net_bytes\": " << stats.net_bytes << ", \"calls\": " << stats.calls << "}";
+  }
+  out << ", \"total_ms\": " << total_ms() << "}";
+  return out.str();
+}
+
+PhaseTimer::PhaseTimer(SolveProfile *profile, Phase phase) : _profile(profile), _phase(phase), _start_bytes(0)
+{
+  if (_profile == nullptr)
+    return;
+  _start_bytes = heap_bytes_in_use();
+  _start = std::chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer()
+{
+  if (_profile == nullptr)
+    return;
+  auto end = std::chrono::steady_clock::now();
+  size_t end_bytes = heap_bytes_in_use();
+
+  PhaseStats &stats = (*_profile)[_phase];
+  stats.wall_ms += std::chrono::duration<double, std::milli>(end - _start).count();
+  if (end_bytes > _start_bytes && end_bytes - _start_bytes > stats.net_bytes)
+    stats.net_bytes = end_bytes - _start_bytes;
+  stats.calls++;
+}
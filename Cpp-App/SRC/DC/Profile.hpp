@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * @enum Phase
+ * @brief Phases of loading and solving a circuit that can be instrumented.
+ */
+enum class Phase
+{
+  PARSE,
+  GROUND_SELECTION,
+  ASSEMBLY,
+  FACTORIZATION,
+  SOLVE,
+  WRITE_BACK,
+  COUNT,
+};
+
+/**
+ * @brief Gets a printable name for a phase.
+ * @param phase Phase to name.
+ * @return Name of the phase.
+ */
+const char *phase_name(Phase phase);
+
+/**
+ * @brief Gets the number of heap bytes currently in use by the process.
+ * @return Bytes in use, or 0 if the platform does not expose it.
+ */
+size_t heap_bytes_in_use();
+
+/**
+ * @struct PhaseStats
+ * @brief Accumulated measurements of a single phase.
+ */
+struct PhaseStats
+{
+  double wall_ms = 0.0;   ///< Total wall time spent in the phase
+  size_t net_bytes = 0;   ///< Largest heap growth from the start to the end of one run of the phase, not its peak
+  size_t calls = 0;       ///< Number of times the phase ran
+};
+
+/**
+ * @struct SolveProfile
+ * @brief Per-phase wall time and memory of a circuit.
+ */
+struct SolveProfile
+{
+  std::array<PhaseStats, static_cast<size_t>(Phase::COUNT)> phases;  ///< Stats indexed by phase
+
+  /**
+     * @brief Gets the stats of a phase.
+     * @param phase Phase to look up.
+     * @return Stats of the phase.
+     */
+  PhaseStats &operator[](Phase phase) { return phases[static_cast<size_t>(phase)]; }
+  const PhaseStats &operator[](Phase phase) const { return phases[static_cast<size_t>(phase)]; }
+
+  /**
+     * @brief Clears all recorded stats.
+     */
+  void reset() { phases = {}; }
+
+  /**
+     * @brief Total wall time over all phases.
+     * @return Wall time in milliseconds.
+     */
+  double total_ms() const;
+
+  /**
+     * @brief Serializes the profile as a JSON object keyed by phase name.
+     * @return JSON text.
+     */
+  std::string to_json() const;
+};
+
+/**
+ * @class PhaseTimer
+ * @brief Scope guard that records one run of a phase into a profile.
+ *
+ * A null profile makes the timer a no-op, so call sites don't need to branch on whether profiling is enabled.
+ */
+class PhaseTimer
+{
+  SolveProfile *_profile;                        ///< Profile to record into, or nullptr
+  Phase _phase;                                  ///< Phase being measured
+  std::chrono::steady_clock::time_point _start;  ///< Time at which the phase started
+  size_t _start_bytes;                           ///< Heap bytes in use when the phase started
+
+public:
+  /**
+     * @brief Starts measuring a phase.
+     * @param profile Profile to record into, nullptr to disable.
+     * @param phase Phase being measured.
+     */
+  PhaseTimer(SolveProfile *profile, Phase phase);
+
+  /**
+     * @brief Stops measuring and records the phase.
+     */
+  ~PhaseTimer();
+
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+};
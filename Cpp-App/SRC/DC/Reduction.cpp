@@ -0,0 +1,161 @@
+#include "Reduction.hpp"
+
+#include <cmath>
+#include <iostream>
+
+#include "../../Include/Eigen/SparseCore"
+#include "Circuit.hpp"
+#include "Solver.hpp"
+
+using SparseMatrix = Eigen::SparseMatrix<double>;
+
+//Orthogonalize a block against the first count columns of V and append what is left of it, column by column. Gram-
+//Schmidt is done twice, and columns that vanish in it are dependent on the basis and dropped (deflation)
+static size_t append_block(Eigen::MatrixXd &V, size_t count, Eigen::MatrixXd &W)
+{
+  for (Eigen::Index j = 0; j < W.cols() && count < size_t(V.cols()); j++)
+  {
+    Eigen::VectorXd w = W.col(j);
+    double norm = w.norm();
+    if (norm == 0.0)
+      continue;
+    for (int pass = 0; pass < 2; pass++) w -= V.leftCols(count) * (V.leftCols(count).transpose() * w);
+    double left = w.norm();
+    if (left <= ReducedModel::deflation * norm)
+      continue;
+    V.col(count++) = w / left;
+  }
+  return count;
+}
+
+ReducedModel ReducedModel::prima(Circuit &circuit, const std::vector<std::string> &ports, size_t moments, double expansion)
+{
+  ReducedModel model;
+  model._ports = ports;
+  model._expansion = expansion;
+  circuit.set_ground();
+  StampList stamps = circuit.build_stamps();
+  const size_t n = stamps.size;
+  const size_t p = ports.size();
+
+  //B injects a unit current into the KCL row of each port, L reads the voltage column of each port
+  Eigen::MatrixXd B = Eigen::MatrixXd::Zero(n, p);
+  Eigen::MatrixXd L = Eigen::MatrixXd::Zero(n, p);
+  for (size_t k = 0; k < p; k++)
+  {
+    if (circuit.get_node(ports[k]) == nullptr)
+    {
+      std::cerr << "Node " << ports[k] << " not found\n";
+      return model;
+    }
+    long row = circuit.node_row(ports[k]);
+    long column = circuit.node_unknown(ports[k]);
+    if (row >= 0)
+      B(row, k) = 1.0;
+    if (column >= 0)
+      L(column, k) = 1.0;
+  }
+
+  //Branch rows negated: [N E; -E^T 0] and [Q 0; 0 L] instead of the symmetric MNA form. Solutions do not change, since
+  //B has no entries in those rows
+  const size_t num_nodes = circuit.num_node_unknowns();
+  auto assemble = [&](const std::vector<MatrixStamp> &list)
+  {
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(list.size());
+    for (auto &stamp : list)
+    {
+      double coefficient = stamp_coefficient(stamp.kind, stamp.sign, circuit.elements()[stamp.element]->value());
+      triplets.emplace_back(stamp.row, stamp.col, stamp.row < num_nodes ? coefficient : -coefficient);
+    }
+    SparseMatrix M(n, n);
+    M.setFromTriplets(triplets.begin(), triplets.end());
+    return M;
+  };
+  SparseMatrix G = assemble(stamps.matrix);
+  SparseMatrix C = assemble(stamps.reactive);
+
+  LinearSolver solver = circuit.make_workspace();
+  SparseMatrix M = G + expansion * C;
+  if (n == 0 || p == 0 || !solver.factorize(M))
+  {
+    std::cerr << "Model reduction: G + " << expansion << " * C is singular\n";
+    return model;
+  }
+  auto solve_block = [&](const Eigen::MatrixXd &R, Eigen::MatrixXd &W)
+  {
+    W.resize(n, R.cols());
+    Eigen::VectorXd x;
+    for (Eigen::Index j = 0; j < R.cols(); j++)
+    {
+      Eigen::VectorXd r = R.col(j);
+      if (!solver.solve(r, x) && !(solver.fall_back() && solver.solve(r, x)))
+        return false;
+      W.col(j) = x;
+    }
+    return true;
+  };
+
+  //Block Arnoldi: V_0 spans (G + s0 C)^-1 B, each next block is -(G + s0 C)^-1 C times the last one
+  Eigen::MatrixXd V(n, std::min(n, moments * p));
+  Eigen::MatrixXd W;
+  if (!solve_block(B, W))
+    return model;
+  size_t count = append_block(V, 0, W);
+  size_t begin = 0;
+  for (size_t k = 1; k < moments && count > begin && count < size_t(V.cols()); k++)
+  {
+    Eigen::MatrixXd R = -(C * V.middleCols(begin, count - begin));
+    if (!solve_block(R, W))
+      return model;
+    begin = count;
+    count = append_block(V, count, W);
+  }
+
+  auto basis = V.leftCols(count);
+  model._G = basis.transpose() * (G * basis);
+  model._C = basis.transpose() * (C * basis);
+  model._B = basis.transpose() * B;
+  model._L = basis.transpose() * L;
+  model._found = true;
+  return model;
+}
+
+Eigen::MatrixXcd ReducedModel::impedance(double omega) const
+{
+  if (!_found)
+    return Eigen::MatrixXcd();
+  Eigen::MatrixXcd pencil = _G.cast<std::complex<double>>() + std::complex<double>(0.0, omega) * _C.cast<std::complex<double>>();
+  Eigen::PartialPivLU<Eigen::MatrixXcd> lu(pencil);
+  if (!(lu.rcond() > 1e-14))
+    return Eigen::MatrixXcd();
+  return _L.transpose().cast<std::complex<double>>() * lu.solve(_B.cast<std::complex<double>>());
+}
+
+bool ReducedModel::transient(double step, size_t steps, const std::function<void(double, Eigen::VectorXd &)> &currents,
+                             std::vector<double> &voltages) const
+{
+  voltages.clear();
+  if (!_found)
+    return false;
+
+  //(C / h + G / 2) x1 = (C / h - G / 2) x0 + B (u0 + u1) / 2
+  Eigen::PartialPivLU<Eigen::MatrixXd> lu(_C / step + _G / 2.0);
+  if (!(lu.rcond() > 1e-14))
+    return false;
+  const Eigen::MatrixXd explicit_part = _C / step - _G / 2.0;
+  const size_t p = _ports.size();
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(order());
+  Eigen::VectorXd u0 = Eigen::VectorXd::Zero(p);
+  Eigen::VectorXd u1 = Eigen::VectorXd::Zero(p);
+  voltages.assign((steps + 1) * p, 0.0);
+  currents(0.0, u0);
+  for (size_t i = 1; i <= steps; i++)
+  {
+    currents(i * step, u1);
+    x = lu.solve(explicit_part * x + _B * ((u0 + u1) / 2.0));
+    Eigen::Map<Eigen::VectorXd>(voltages.data() + i * p, p) = _L.transpose() * x;
+    std::swap(u0, u1);
+  }
+  return true;
+}
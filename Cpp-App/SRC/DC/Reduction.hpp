@@ -0,0 +1,97 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../../Include/Eigen/Dense"
+
+class Circuit;
+
+/**
+ * @class ReducedModel
+ * @brief Small multiport model of a large linear network, from PRIMA moment matching.
+ *
+ * The network is seen from a few port nodes: currents are injected into the ports and the port voltages are observed,
+ * with the independent sources of the circuit set to zero (voltage sources shorted, current sources open). With
+ * (G + s * C) X = B * u and y = L^T * X, block Arnoldi builds an orthonormal basis V of the Krylov space of
+ * (G + s0 * C)^-1 * C and (G + s0 * C)^-1 * B, factorizing G + s0 * C once. The reduced system is the congruence
+ * V^T * G * V, V^T * C * V, V^T * B, V^T * L, which matches the first moments of the port impedance around s0 and
+ * stays passive for RLC networks: the branch rows of G and C are negated first, so that G + G^T and C are positive
+ * semidefinite and congruence keeps them so.
+ */
+class ReducedModel
+{
+  std::vector<std::string> _ports;  ///< Names of the port nodes
+  Eigen::MatrixXd _G;               ///< Reduced V^T * G * V
+  Eigen::MatrixXd _C;               ///< Reduced V^T * C * V
+  Eigen::MatrixXd _B;               ///< Reduced V^T * B, one column per port
+  Eigen::MatrixXd _L;               ///< Reduced V^T * L, one column per port
+  double _expansion;                ///< Expansion point s0 of the matched moments
+  bool _found;                      ///< The reduction succeeded
+
+public:
+  static constexpr double deflation = 1e-10;  ///< Relative norm below which a Krylov vector is dropped as dependent
+
+  /**
+     * @brief Reduces a circuit with PRIMA. Sets the ground of the circuit.
+     * @param circuit Circuit to reduce, with the backend settings to factorize G + s0 * C with.
+     * @param ports Names of the port nodes.
+     * @param moments Number of block moments matched, the order is at most moments * ports.size().
+     * @param expansion Real expansion point s0 in rad/s. 0 matches the DC moments, a positive s0 is needed when G is
+     * singular, a node connected only through capacitors.
+     * @return Reduced model, not found if a port does not exist or G + s0 * C is singular.
+     */
+  static ReducedModel prima(Circuit &circuit, const std::vector<std::string> &ports, size_t moments, double expansion = 0.0);
+
+  /**
+     * @brief Checks if the reduction succeeded.
+     */
+  bool found() const { return _found; }
+
+  /**
+     * @brief Gets the order of the reduced model, the number of its state variables.
+     */
+  size_t order() const { return _G.rows(); }
+
+  /**
+     * @brief Gets the expansion point s0 in rad/s.
+     */
+  double expansion() const { return _expansion; }
+
+  /**
+     * @brief Gets the names of the port nodes.
+     */
+  const std::vector<std::string> &ports() const { return _ports; }
+
+  /**
+     * @brief Gets the reduced matrices, for use in another simulator.
+     */
+  const Eigen::MatrixXd &G() const { return _G; }
+  const Eigen::MatrixXd &C() const { return _C; }
+  const Eigen::MatrixXd &B() const { return _B; }
+  const Eigen::MatrixXd &L() const { return _L; }
+
+  /**
+     * @brief AC analysis: port impedance matrix Z(j * omega), port voltages per unit port current.
+     * @param omega Angular frequency in rad/s.
+     * @return Z, ports x ports, empty if the reduced pencil is singular at that frequency.
+     */
+  Eigen::MatrixXcd impedance(double omega) const;
+
+  /**
+     * @brief Transient analysis from rest with the trapezoidal rule, one dense factorization for all steps.
+     * @param step Time step in seconds.
+     * @param steps Number of steps.
+     * @param currents Called with a time and a vector of ports.size() entries, to fill with the port currents at that time.
+     * @param voltages Set to the port voltages at the times 0, step, ..., steps * step, one row of ports per time.
+     * @return False if the model was not found or the step matrix is singular.
+     */
+  bool transient(double step, size_t steps, const std::function<void(double, Eigen::VectorXd &)> &currents,
+                 std::vector<double> &voltages) const;
+
+private:
+  ReducedModel() : _expansion(0.0), _found(false) {}
+};
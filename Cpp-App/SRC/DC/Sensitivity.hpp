@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @struct Sensitivity
+ * @brief Result of Circuit::sensitivities, the derivative of some node voltages with respect to every element value.
+ */
+struct Sensitivity
+{
+  bool found = false;                ///< False if the circuit could not be solved, derivatives is empty then
+  std::vector<std::string> outputs;  ///< Names of the output nodes, in the order they were asked for
+  size_t num_elements = 0;           ///< Number of elements, the length of one row of derivatives
+  std::vector<double> derivatives;   ///< dV_output / d value, one row per output indexed by Element::index()
+
+  /**
+     * @brief Gets the derivative of an output with respect to one element value: volts per ohm for a resistor, volts
+     * per volt or ampere for a source, volts per unit of gain for a dependent source.
+     * @param output Position of the output in outputs.
+     * @param index Element::index() of the element.
+     * @return dV_output / d value.
+     */
+  double derivative(size_t output, size_t index) const { return derivatives[output * num_elements + index]; }
+
+  /**
+     * @brief Gets the derivatives of one output with respect to every element.
+     * @param output Position of the output in outputs.
+     * @return Pointer to num_elements derivatives indexed by Element::index().
+     */
+  const double *row(size_t output) const { return derivatives.data() + output * num_elements; }
+};
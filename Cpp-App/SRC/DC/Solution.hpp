@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct Solution
+ * @brief Result of Circuit::evaluate, a snapshot that is independent of the circuit's nodes and elements.
+ */
+struct Solution
+{
+  bool found = false;            ///< False if the system could not be solved, the arrays are empty then
+  std::vector<double> voltages;  ///< Voltage of every node, indexed by Node::id()
+  std::vector<double> currents;  ///< Current of every element, indexed by Element::index(), signed like get_current()
+
+  /**
+     * @brief Gets the voltage of a node.
+     * @param id Node::id() of the node.
+     * @return Voltage of the node.
+     */
+  double voltage(size_t id) const { return voltages[id]; }
+
+  /**
+     * @brief Gets the current of an element.
+     * @param index Element::index() of the element.
+     * @return Current through the element.
+     */
+  double current(size_t index) const { return currents[index]; }
+};
@@ -0,0 +1,454 @@
+#include "Solver.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../../Include/Eigen/IterativeLinearSolvers"
+#include "../../Include/Eigen/SparseCholesky"
+#include "../../Include/Eigen/SparseLU"
+
+using SparseMatrix = Eigen::SparseMatrix<double>;
+using SparseMatrixF = Eigen::SparseMatrix<float>;
+
+//Eigen only hands out the transposed view of a SparseLU from a non-const one, although solving through it just reads
+//the factors
+template <typename LU>
+static auto transpose_view(const LU &lu)
+{
+  return const_cast<LU &>(lu).transpose();
+}
+
+using Ordering = Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int>;
+
+//Ordering the running factorization of this thread starts from, nullptr to analyze the pattern
+static thread_local const Ordering *seeded_ordering = nullptr;
+
+//A fill-reducing ordering that hands out the seeded permutation when one of the right size is set, so that a solver
+//seeded from another one skips COLAMD or AMD and only builds its elimination tree
+template <typename Default>
+struct SeededOrdering
+{
+  using PermutationType = Ordering;
+
+  template <typename MatrixType>
+  void operator()(const MatrixType &A, PermutationType &perm)
+  {
+    if (seeded_ordering != nullptr && seeded_ordering->size() == A.cols())
+      perm = *seeded_ordering;
+    else
+      Default()(A, perm);
+  }
+};
+
+//Sets the seeded ordering for the factorizations of one scope
+struct SeedScope
+{
+  explicit SeedScope(const Ordering *ordering) { seeded_ordering = ordering; }
+  ~SeedScope() { seeded_ordering = nullptr; }
+};
+
+struct LinearSolver::Impl
+{
+  SparseMatrix matrix;  ///< Copy of the factorized matrix, iterative solvers keep a reference to it
+  Eigen::PartialPivLU<Eigen::MatrixXd> dense_lu;
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> dense_qr;
+  Eigen::SparseLU<SparseMatrix, SeededOrdering<Eigen::COLAMDOrdering<int>>> sparse_lu;
+  Eigen::SimplicialLDLT<SparseMatrix, Eigen::Lower, SeededOrdering<Eigen::AMDOrdering<int>>> ldlt;
+  Eigen::ConjugateGradient<SparseMatrix, Eigen::Lower | Eigen::Upper, Eigen::IncompleteCholesky<double>> cg;
+  Eigen::BiCGSTAB<SparseMatrix, Eigen::IncompleteLUT<double>> bicgstab;
+
+  //Single precision factorizations for mixed precision solves
+  double norm_inf = 0;  ///< Infinity norm of matrix, scales the refinement stopping test
+  double norm_one = 0;  ///< One norm of matrix, the infinity norm of its transpose for transposed solves
+  Eigen::PartialPivLU<Eigen::MatrixXf> dense_lu_f;
+  Eigen::SparseLU<SparseMatrixF, SeededOrdering<Eigen::COLAMDOrdering<int>>> sparse_lu_f;
+  Eigen::SimplicialLDLT<SparseMatrixF, Eigen::Lower, SeededOrdering<Eigen::AMDOrdering<int>>> ldlt_f;
+
+  //Ordering handed over by seed(), used by the first analysis with its backend
+  Ordering ordering;
+  Backend ordering_backend = Backend::AUTO;
+
+  /**
+     * @brief Solves against whichever single precision factorization is current.
+     */
+  Eigen::VectorXf solve_single(Backend backend, const Eigen::VectorXf &b, bool transposed) const
+  {
+    switch (backend)
+    {
+      case Backend::DENSE_LU: return transposed ? Eigen::VectorXf(dense_lu_f.transpose().solve(b)) : dense_lu_f.solve(b);
+      case Backend::SPARSE_LU: return transposed ? Eigen::VectorXf(transpose_view(sparse_lu_f).solve(b)) : sparse_lu_f.solve(b);
+      default: return ldlt_f.solve(b);
+    }
+  }
+};
+
+const char *backend_name(Backend backend)
+{
+  switch (backend)
+  {
+    case Backend::AUTO: return "auto";
+    case Backend::DENSE_LU: return "dense_lu";
+    case Backend::DENSE_QR: return "dense_qr";
+    case Backend::SPARSE_LU: return "sparse_lu";
+    case Backend::SPARSE_CHOLESKY: return "sparse_cholesky";
+    case Backend::CONJUGATE_GRADIENT: return "conjugate_gradient";
+    case Backend::BICGSTAB: return "bicgstab";
+    case Backend::FIXED_SIZE: return "fixed_size";
+    default: return "unknown";
+  }
+}
+
+bool backend_from_name(const std::string &name, Backend &backend)
+{
+  for (Backend candidate : {Backend::AUTO, Backend::DENSE_LU, Backend::DENSE_QR, Backend::SPARSE_LU, Backend::SPARSE_CHOLESKY,
+                            Backend::CONJUGATE_GRADIENT, Backend::BICGSTAB, Backend::FIXED_SIZE})
+  {
+    if (name == backend_name(candidate))
+    {
+      backend = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+MatrixTraits MatrixTraits::analyze(const SparseMatrix &A)
+{
+  MatrixTraits traits;
+  traits.size = A.rows();
+  traits.non_zeros = A.nonZeros();
+  traits.density = traits.size ? double(traits.non_zeros) / (double(traits.size) * double(traits.size)) : 0.0;
+
+  //MNA matrices are exactly symmetric when they are symmetric at all (the B and C blocks are +-1), so a tight
+  //tolerance is enough
+  SparseMatrix transposed = A.transpose();
+  traits.symmetric = (A - transposed).norm() <= 1e-12 * A.norm();
+  if (!traits.symmetric)
+    return traits;
+
+  //A symmetric matrix with a positive, diagonally dominant diagonal is positive definite for any grounded,
+  //connected resistor network; the Cholesky factorization confirms it
+  traits.positive_definite = true;
+  for (int col = 0; col < A.outerSize() && traits.positive_definite; col++)
+  {
+    double diagonal = 0;
+    double off_diagonal = 0;
+    for (SparseMatrix::InnerIterator it(A, col); it; ++it)
+    {
+      if (it.row() == col)
+        diagonal += it.value();
+      else
+        off_diagonal += std::abs(it.value());
+    }
+    traits.positive_definite = diagonal > 0 && diagonal >= off_diagonal * (1 - 1e-12);
+  }
+  return traits;
+}
+
+LinearSolver::LinearSolver(Backend backend)
+    : _impl(std::make_unique<Impl>()),
+      _requested(backend),
+      _backend(Backend::AUTO),
+      _factorized(false),
+      _mixed_precision(false),
+      _single(false)
+{
+}
+
+LinearSolver::~LinearSolver() = default;
+
+LinearSolver::LinearSolver(const LinearSolver &other) : LinearSolver(other._requested)
+{
+  _mixed_precision = other._mixed_precision;
+}
+
+LinearSolver &LinearSolver::operator=(const LinearSolver &other)
+{
+  if (this != &other)
+  {
+    *this = LinearSolver(other._requested);
+    _mixed_precision = other._mixed_precision;
+  }
+  return *this;
+}
+
+LinearSolver::LinearSolver(LinearSolver &&other) noexcept = default;
+
+LinearSolver &LinearSolver::operator=(LinearSolver &&other) noexcept = default;
+
+void LinearSolver::seed(const LinearSolver &analyzed)
+{
+  const Impl &other = *analyzed._impl;
+  _impl->ordering_backend = Backend::AUTO;
+  if (!analyzed._factorized)
+    return;
+  //The dense backends have no symbolic analysis and the iterative ones only their preconditioner, nothing to share
+  if (analyzed._backend == Backend::SPARSE_LU)
+    _impl->ordering = analyzed._single ? other.sparse_lu_f.colsPermutation() : other.sparse_lu.colsPermutation();
+  else if (analyzed._backend == Backend::SPARSE_CHOLESKY)
+    _impl->ordering = analyzed._single ? other.ldlt_f.permutationPinv() : other.ldlt.permutationPinv();
+  else
+    return;
+  _impl->ordering_backend = analyzed._backend;
+}
+
+Backend LinearSolver::choose(const MatrixTraits &traits)
+{
+  if (traits.size <= dense_limit || (traits.density >= dense_density && traits.size <= dense_density_limit))
+    return Backend::DENSE_LU;
+
+  if (traits.symmetric && traits.positive_definite)
+    return traits.size >= iterative_limit ? Backend::CONJUGATE_GRADIENT : Backend::SPARSE_CHOLESKY;
+
+  //BiCGSTAB needs a good preconditioner to beat a direct solve, and the zero diagonal block of voltage sources
+  //defeats incomplete LU, so it only pays off for huge systems
+  return traits.size >= iterative_limit ? Backend::BICGSTAB : Backend::SPARSE_LU;
+}
+
+bool LinearSolver::factorize(const SparseMatrix &A)
+{
+  _impl->matrix = A;
+  _impl->matrix.makeCompressed();
+  _factorized = false;
+  _single = false;
+
+  Backend backend = _requested;
+  if (backend == Backend::AUTO)
+  {
+    _traits = MatrixTraits::analyze(_impl->matrix);
+    backend = choose(_traits);
+  }
+  //Circuit handles FIXED_SIZE on small systems, larger ones get the general dense LU
+  if (backend == Backend::FIXED_SIZE)
+    backend = Backend::DENSE_LU;
+
+  if (_mixed_precision && factorize_single(backend))
+    return true;
+  if (factorize_with(backend))
+    return true;
+
+  //Cholesky and the preconditioners fail on matrices that aren't definite, LU fails on singular ones
+  switch (backend)
+  {
+    case Backend::SPARSE_CHOLESKY:
+    case Backend::CONJUGATE_GRADIENT:
+    case Backend::BICGSTAB:
+      if (factorize_with(Backend::SPARSE_LU))
+        return true;
+      [[fallthrough]];
+    case Backend::DENSE_LU:
+    case Backend::SPARSE_LU: return factorize_with(Backend::DENSE_QR);
+    default: return false;
+  }
+}
+
+bool LinearSolver::refactorize(const SparseMatrix &A)
+{
+  if (!_factorized)
+    return factorize(A);
+
+  _impl->matrix = A;
+  _impl->matrix.makeCompressed();
+  _factorized = false;
+  if (_single ? factorize_single(_backend, true) : factorize_with(_backend, true))
+    return true;
+  return factorize(A);
+}
+
+bool LinearSolver::factorize_with(Backend backend, bool numeric_only)
+{
+  const SparseMatrix &A = _impl->matrix;
+  bool ok = false;
+  SeedScope seed(_impl->ordering_backend == backend ? &_impl->ordering : nullptr);
+
+  switch (backend)
+  {
+    case Backend::DENSE_LU:
+      _impl->dense_lu.compute(Eigen::MatrixXd(A));
+      //PartialPivLU doesn't report singular matrices, so check the estimated condition instead
+      ok = A.rows() == 0 || _impl->dense_lu.rcond() > 1e-14;
+      break;
+    case Backend::DENSE_QR:
+      _impl->dense_qr.compute(Eigen::MatrixXd(A));
+      ok = true;
+      break;
+    case Backend::SPARSE_LU:
+      if (numeric_only)
+        _impl->sparse_lu.factorize(A);
+      else
+        _impl->sparse_lu.compute(A);
+      ok = _impl->sparse_lu.info() == Eigen::Success;
+      break;
+    case Backend::SPARSE_CHOLESKY:
+      if (numeric_only)
+        _impl->ldlt.factorize(A);
+      else
+        _impl->ldlt.compute(A);
+      //LDLT succeeds on indefinite matrices too, a positive D is what proves definiteness
+      ok = _impl->ldlt.info() == Eigen::Success && (A.rows() == 0 || _impl->ldlt.vectorD().minCoeff() > 0);
+      break;
+    case Backend::CONJUGATE_GRADIENT:
+      //IncompleteCholesky asserts on a zero diagonal (voltage source rows), those systems aren't definite anyway
+      if (A.rows() != 0 && A.diagonal().minCoeff() <= 0)
+        break;
+      _impl->cg.setTolerance(1e-12);
+      _impl->cg.compute(A);
+      ok = _impl->cg.info() == Eigen::Success;
+      break;
+    case Backend::BICGSTAB:
+      _impl->bicgstab.setTolerance(1e-12);
+      _impl->bicgstab.compute(A);
+      ok = _impl->bicgstab.info() == Eigen::Success;
+      break;
+    default: break;
+  }
+
+  if (ok)
+  {
+    _backend = backend;
+    _factorized = true;
+  }
+  return ok;
+}
+
+bool LinearSolver::factorize_single(Backend backend, bool numeric_only)
+{
+  const SparseMatrix &A = _impl->matrix;
+  bool ok = false;
+  SeedScope seed(_impl->ordering_backend == backend ? &_impl->ordering : nullptr);
+
+  switch (backend)
+  {
+    case Backend::DENSE_LU:
+      //Densified straight into the float factors, a double dense copy on the way would outweigh them
+      _impl->dense_lu_f.compute(A.cast<float>());
+      ok = A.rows() == 0 || _impl->dense_lu_f.rcond() > 1e-6f;
+      break;
+    case Backend::SPARSE_LU:
+      if (numeric_only)
+        _impl->sparse_lu_f.factorize(A.cast<float>());
+      else
+        _impl->sparse_lu_f.compute(A.cast<float>());
+      ok = _impl->sparse_lu_f.info() == Eigen::Success;
+      break;
+    case Backend::SPARSE_CHOLESKY:
+      if (numeric_only)
+        _impl->ldlt_f.factorize(A.cast<float>());
+      else
+        _impl->ldlt_f.compute(A.cast<float>());
+      ok = _impl->ldlt_f.info() == Eigen::Success && (A.rows() == 0 || _impl->ldlt_f.vectorD().minCoeff() > 0);
+      break;
+    default: break;
+  }
+
+  if (ok)
+  {
+    //Infinity norm (largest absolute row sum), A is column major so accumulate per row; the one norm comes per column
+    Eigen::VectorXd row_sums = Eigen::VectorXd::Zero(A.rows());
+    double norm_one = 0.0;
+    for (int col = 0; col < A.outerSize(); col++)
+    {
+      double col_sum = 0.0;
+      for (SparseMatrix::InnerIterator it(A, col); it; ++it)
+      {
+        row_sums(it.row()) += std::abs(it.value());
+        col_sum += std::abs(it.value());
+      }
+      norm_one = std::max(norm_one, col_sum);
+    }
+    _impl->norm_inf = A.rows() ? row_sums.maxCoeff() : 0.0;
+    _impl->norm_one = norm_one;
+
+    _backend = backend;
+    _factorized = true;
+    _single = true;
+  }
+  return ok;
+}
+
+bool LinearSolver::fall_back()
+{
+  _factorized = false;
+  if (_single)
+  {
+    _single = false;
+    if (factorize_with(_backend))
+      return true;
+  }
+  return factorize_with(Backend::SPARSE_LU) || factorize_with(Backend::DENSE_QR);
+}
+
+bool LinearSolver::solve_refined(const Eigen::VectorXd &b, Eigen::VectorXd &x, bool transposed) const
+{
+  //A transposed solve refines against the residual of A^T
+  const SparseMatrix transpose = transposed ? SparseMatrix(_impl->matrix.transpose()) : SparseMatrix();
+  const SparseMatrix &A = transposed ? transpose : _impl->matrix;
+  const double norm_inf = transposed ? _impl->norm_one : _impl->norm_inf;
+  const double b_norm = b.lpNorm<Eigen::Infinity>();
+  x = _impl->solve_single(_backend, b.cast<float>(), transposed).cast<double>();
+
+  //Stop once the normwise backward error is at double precision level, give up if a step doesn't halve the residual
+  double previous = std::numeric_limits<double>::infinity();
+  for (int step = 0; step < max_refinement_steps; step++)
+  {
+    Eigen::VectorXd r = b - A * x;
+    double r_norm = r.lpNorm<Eigen::Infinity>();
+    double tolerance = 8 * std::numeric_limits<double>::epsilon() * (norm_inf * x.lpNorm<Eigen::Infinity>() + b_norm);
+    if (r_norm <= tolerance)
+      return x.allFinite();
+    if (!(r_norm < 0.5 * previous))
+      return false;
+    previous = r_norm;
+
+    //Scale the residual before rounding it to float so small corrections don't underflow
+    Eigen::VectorXf scaled = (r / r_norm).cast<float>();
+    x += r_norm * _impl->solve_single(_backend, scaled, transposed).cast<double>();
+  }
+  return false;
+}
+
+bool LinearSolver::concurrent_solve() const
+{
+  return _factorized && _backend != Backend::CONJUGATE_GRADIENT && _backend != Backend::BICGSTAB;
+}
+
+bool LinearSolver::solve(const Eigen::VectorXd &b, Eigen::VectorXd &x) const
+{
+  if (!_factorized)
+    return false;
+  if (_single)
+    return solve_refined(b, x);
+
+  switch (_backend)
+  {
+    case Backend::DENSE_LU: x = _impl->dense_lu.solve(b); return true;
+    case Backend::DENSE_QR: x = _impl->dense_qr.solve(b); return true;
+    case Backend::SPARSE_LU: x = _impl->sparse_lu.solve(b); return _impl->sparse_lu.info() == Eigen::Success;
+    case Backend::SPARSE_CHOLESKY: x = _impl->ldlt.solve(b); return _impl->ldlt.info() == Eigen::Success;
+    case Backend::CONJUGATE_GRADIENT: x = _impl->cg.solve(b); return _impl->cg.info() == Eigen::Success;
+    case Backend::BICGSTAB: x = _impl->bicgstab.solve(b); return _impl->bicgstab.info() == Eigen::Success;
+    default: return false;
+  }
+}
+
+bool LinearSolver::solve_transposed(const Eigen::VectorXd &b, Eigen::VectorXd &x) const
+{
+  if (!_factorized)
+    return false;
+  if (_single)
+    return solve_refined(b, x, true);
+
+  switch (_backend)
+  {
+    case Backend::DENSE_LU: x = _impl->dense_lu.transpose().solve(b); return true;
+    case Backend::DENSE_QR: x = _impl->dense_qr.transpose().solve(b); return true;
+    case Backend::SPARSE_LU:
+      x = transpose_view(_impl->sparse_lu).solve(b);
+      return _impl->sparse_lu.info() == Eigen::Success;
+    //Cholesky and CG only accept symmetric matrices, A^T is A
+    case Backend::SPARSE_CHOLESKY:
+    case Backend::CONJUGATE_GRADIENT: return solve(b, x);
+    default: return false;
+  }
+}
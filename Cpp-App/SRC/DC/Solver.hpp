@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "../../Include/Eigen/Dense"
+#include "../../Include/Eigen/SparseCore"
+
+/**
+ * @enum Backend
+ * @brief Linear solvers that can be used for the MNA system.
+ */
+enum class Backend
+{
+  AUTO,                //Pick one from the size, density and symmetry of the matrix
+  DENSE_LU,            //Eigen::PartialPivLU
+  DENSE_QR,            //Eigen::ColPivHouseholderQR, slow but copes with singular systems
+  SPARSE_LU,           //Eigen::SparseLU with COLAMD ordering
+  SPARSE_CHOLESKY,     //Eigen::SimplicialLDLT, symmetric positive definite systems only
+  CONJUGATE_GRADIENT,  //Eigen::ConjugateGradient with incomplete Cholesky, symmetric positive definite systems only
+  BICGSTAB,            //Eigen::BiCGSTAB with incomplete LUT
+  FIXED_SIZE,          //Unrolled LU on Eigen::Matrix<double, N, N>, run by Circuit for at most 16 unknowns, DENSE_LU above
+};
+
+/**
+ * @brief Gets a printable name for a backend.
+ * @param backend Backend to name.
+ * @return Name of the backend.
+ */
+const char *backend_name(Backend backend);
+
+/**
+ * @brief Parses a backend name as printed by backend_name.
+ * @param name Name to parse.
+ * @param backend Set to the parsed backend on success.
+ * @return True if the name is known, false otherwise.
+ */
+bool backend_from_name(const std::string &name, Backend &backend);
+
+/**
+ * @struct MatrixTraits
+ * @brief Structural properties of a matrix used to pick a backend.
+ */
+struct MatrixTraits
+{
+  size_t size = 0;                 ///< Number of rows (the matrix is square)
+  size_t non_zeros = 0;            ///< Number of stored non zero entries
+  double density = 0.0;            ///< non_zeros / size^2
+  bool symmetric = false;          ///< A == A^T
+  bool positive_definite = false;  ///< Symmetric with a positive, diagonally dominant diagonal
+
+  /**
+     * @brief Analyzes a matrix.
+     * @param A Matrix to analyze.
+     * @return Traits of the matrix.
+     */
+  static MatrixTraits analyze(const Eigen::SparseMatrix<double> &A);
+};
+
+/**
+ * @class LinearSolver
+ * @brief Factorizes a square sparse matrix with a chosen backend and solves against it.
+ *
+ * Factorizing and solving are separate so that one factorization can serve many right-hand sides.
+ * Copies carry the backend selection only, not the factorization.
+ */
+class LinearSolver
+{
+  struct Impl;
+  std::unique_ptr<Impl> _impl;  ///< Factorizations, kept out of the header to avoid pulling in every Eigen solver
+  Backend _requested;           ///< Backend asked for by the user
+  Backend _backend;             ///< Backend used by the current factorization
+  MatrixTraits _traits;         ///< Traits of the factorized matrix (only filled for AUTO)
+  bool _factorized;             ///< True once a factorization succeeded
+  bool _mixed_precision;        ///< Factorize in single precision and refine in double when the backend allows it
+  bool _single;                 ///< True if the current factorization is in single precision
+
+public:
+  static constexpr size_t dense_limit = 100;           ///< Systems up to this size are solved densely
+  static constexpr double dense_density = 0.2;         ///< Denser systems up to dense_density_limit are solved densely too
+  static constexpr size_t dense_density_limit = 1000;  ///< Largest size for which density alone selects a dense solve
+  static constexpr size_t iterative_limit = 200000;    ///< Systems from this size on use an iterative backend when possible
+  static constexpr int max_refinement_steps = 10;      ///< Iterative refinement steps before a single precision solve gives up
+
+  /**
+     * @brief Constructor for LinearSolver.
+     * @param backend Backend to use, AUTO to pick one per matrix.
+     */
+  explicit LinearSolver(Backend backend = Backend::AUTO);
+
+  /**
+     * @brief Destructor for LinearSolver.
+     */
+  ~LinearSolver();
+
+  LinearSolver(const LinearSolver &other);
+  LinearSolver &operator=(const LinearSolver &other);
+  LinearSolver(LinearSolver &&other) noexcept;
+  LinearSolver &operator=(LinearSolver &&other) noexcept;
+
+  /**
+     * @brief Hands over the fill-reducing ordering of another solver's factorization, so that the next sparse LU or
+     * Cholesky factorization with the same backend and size starts from it instead of analyzing the pattern again.
+     * Solvers that factorize matrices of one pattern on several threads share one analysis this way.
+     * @param analyzed Solver holding a factorization, nothing is shared if it has none or a dense or iterative one.
+     */
+  void seed(const LinearSolver &analyzed);
+
+  /**
+     * @brief Sets the backend to use for the next factorization.
+     * @param backend Backend to use, AUTO to pick one per matrix.
+     */
+  void set_backend(Backend backend) { _requested = backend; }
+
+  /**
+     * @brief Factorizes in single precision and recovers double accuracy by iterative refinement.
+     * Applies to the direct backends (dense LU, sparse LU and sparse Cholesky); the others ignore it.
+     * @param enable True to use mixed precision.
+     */
+  void set_mixed_precision(bool enable) { _mixed_precision = enable; }
+
+  /**
+     * @brief Checks if the current factorization is in single precision.
+     * @return True if solves are refined from a single precision factorization.
+     */
+  bool single_precision() const { return _single; }
+
+  /**
+     * @brief Gets the backend asked for by the user.
+     * @return Requested backend.
+     */
+  Backend requested() const { return _requested; }
+
+  /**
+     * @brief Gets the backend used by the current factorization.
+     * @return Backend in use, AUTO if nothing was factorized yet.
+     */
+  Backend backend() const { return _backend; }
+
+  /**
+     * @brief Gets the traits of the last matrix analyzed for AUTO selection.
+     * @return Matrix traits.
+     */
+  const MatrixTraits &traits() const { return _traits; }
+
+  /**
+     * @brief Picks a backend for a matrix.
+     * @param traits Traits of the matrix.
+     * @return Backend to use.
+     */
+  static Backend choose(const MatrixTraits &traits);
+
+  /**
+     * @brief Factorizes a matrix, falling back to a more general backend when the chosen one fails.
+     * @param A Matrix to factorize.
+     * @return True if a factorization was computed, false otherwise.
+     */
+  bool factorize(const Eigen::SparseMatrix<double> &A);
+
+  /**
+     * @brief Factorizes a matrix with the same sparsity pattern as the current factorization, keeping the backend and
+     * reusing the symbolic analysis (ordering, elimination tree) of the sparse direct backends.
+     * Falls back to factorize() if there is no factorization yet or the numeric factorization fails.
+     * @param A Matrix to factorize, same pattern as the last one.
+     * @return True if a factorization was computed, false otherwise.
+     */
+  bool refactorize(const Eigen::SparseMatrix<double> &A);
+
+  /**
+     * @brief Solves A * x = b against the current factorization.
+     * @param b Right-hand side.
+     * @param x Solution.
+     * @return True if solved, false if there is no factorization, an iterative backend did not converge or iterative
+     * refinement of a single precision factorization stalled.
+     */
+  bool solve(const Eigen::VectorXd &b, Eigen::VectorXd &x) const;
+
+  /**
+     * @brief Solves A^T * x = b against the current factorization of A, as needed by adjoint analyses. The symmetric
+     * backends reuse solve(); BiCGSTAB has no transposed solve and fails, fall_back() replaces it with one that does.
+     * @param b Right-hand side.
+     * @param x Solution.
+     * @return True if solved, false if there is no factorization, the backend is BiCGSTAB or refinement stalled.
+     */
+  bool solve_transposed(const Eigen::VectorXd &b, Eigen::VectorXd &x) const;
+
+  /**
+     * @brief Checks if several threads may call solve() at once against the current factorization. The direct
+     * backends only read their factors; Eigen's iterative solvers record iteration counts and errors during a solve.
+     * @return True if solve() is safe to call concurrently.
+     */
+  bool concurrent_solve() const;
+
+  /**
+     * @brief Replaces the current factorization after solve() failed: a single precision factorization is redone in
+     * double with the same backend, an iterative backend is replaced with a sparse LU of the same matrix.
+     * @return True if the new factorization succeeded.
+     */
+  bool fall_back();
+
+private:
+  /**
+     * @brief Factorizes the stored matrix with one backend.
+     * @param backend Backend to use, never AUTO.
+     * @param numeric_only Reuse the symbolic analysis of the previous factorization with this backend.
+     * @return True if the factorization succeeded.
+     */
+  bool factorize_with(Backend backend, bool numeric_only = false);
+
+  /**
+     * @brief Factorizes the stored matrix with one backend in single precision.
+     * @param backend Backend to use, one of DENSE_LU, SPARSE_LU or SPARSE_CHOLESKY.
+     * @param numeric_only Reuse the symbolic analysis of the previous factorization with this backend.
+     * @return True if the factorization succeeded.
+     */
+  bool factorize_single(Backend backend, bool numeric_only = false);
+
+  /**
+     * @brief Solves against the single precision factorization and refines the solution in double.
+     * @param b Right-hand side.
+     * @param x Solution.
+     * @param transposed Solve with A^T instead of A.
+     * @return True if the residual reached double precision accuracy.
+     */
+  bool solve_refined(const Eigen::VectorXd &b, Eigen::VectorXd &x, bool transposed = false) const;
+};
@@ -0,0 +1,198 @@
+#include "Spice.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "Input.hpp"
+#include "UnionFind.hpp"
+
+//Hash looked up by string_view, so a node name is only copied the first time it is seen
+struct NameHash
+{
+  using is_transparent = void;
+  size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+};
+
+//One element line, nodes by id and the name as a slice of the name arena
+struct Record
+{
+  char kind;      ///< r, v or i
+  uint32_t pos;   ///< Id of the first node
+  uint32_t neg;   ///< Id of the second node
+  double value;   ///< Value with its scale applied
+  size_t name;    ///< Offset of the name in the arena
+  size_t length;  ///< Length of the name
+};
+
+//A number with an optional SPICE scale suffix, any letters after the scale are units
+static bool parse_value(std::string_view token, double &value)
+{
+  if (!token.empty() && token[0] == '+')
+    token.remove_prefix(1);
+  auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+  if (error != std::errc())
+    return false;
+  std::string suffix(end, token.data() + token.size());
+  for (char &c : suffix) c = char(std::tolower(static_cast<unsigned char>(c)));
+  if (suffix.compare(0, 3, "meg") == 0)
+    value *= 1e6;
+  else if (!suffix.empty())
+    switch (suffix[0])
+    {
+      case 'f': value *= 1e-15; break;
+      case 'p': value *= 1e-12; break;
+      case 'n': value *= 1e-9; break;
+      case 'u': value *= 1e-6; break;
+      case 'm': value *= 1e-3; break;
+      case 'k': value *= 1e3; break;
+      case 'g': value *= 1e9; break;
+      case 't': value *= 1e12; break;
+      default: break;
+    }
+  return true;
+}
+
+Circuit SpiceReader::load(const std::string &file_path)
+{
+  InputFile f(file_path);
+  if (!f)
+  {
+    std::cerr << "Error: Cannot read " << file_path << "\n";
+    return Circuit();
+  }
+
+  std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> ids;
+  std::vector<const std::string *> names;
+  std::vector<Record> records;
+  std::string arena;
+  auto node_id = [&](std::string_view name)
+  {
+    auto it = ids.find(name);
+    if (it == ids.end())
+    {
+      it = ids.emplace(std::string(name), uint32_t(names.size())).first;
+      names.push_back(&it->first);
+    }
+    return it->second;
+  };
+
+  //Returns false on a line that is neither blank, a comment, a dot command nor an R, V or I element
+  auto parse_line = [&](std::string_view line)
+  {
+    std::string_view tokens[4];
+    size_t count = 0;
+    size_t i = 0;
+    while (count < 4)
+    {
+      while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+      if (i == line.size())
+        break;
+      size_t begin = i;
+      while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') i++;
+      tokens[count++] = line.substr(begin, i - begin);
+    }
+    if (count == 0 || tokens[0][0] == '*' || tokens[0][0] == '.')
+      return true;
+    char kind = char(std::tolower(static_cast<unsigned char>(tokens[0][0])));
+    Record record{kind, 0, 0, 0.0, arena.size(), tokens[0].size()};
+    if (count < 4 || (kind != 'r' && kind != 'v' && kind != 'i') || !parse_value(tokens[3], record.value))
+      return false;
+    record.pos = node_id(tokens[1]);
+    record.neg = node_id(tokens[2]);
+    arena.append(tokens[0]);
+    records.push_back(record);
+    return true;
+  };
+
+  //Whole lines are parsed out of each block, a partial last line waits for the next one
+  std::string buffer;
+  size_t line_number = 0;
+  for (bool last = false; !last;)
+  {
+    size_t kept = buffer.size();
+    buffer.resize(kept + InputFile::buffer_size);
+    f.read(buffer.data() + kept, InputFile::buffer_size);
+    buffer.resize(kept + size_t(f.gcount()));
+    last = f.gcount() == 0;
+    size_t begin = 0;
+    while (begin < buffer.size())
+    {
+      size_t end = buffer.find('\n', begin);
+      if (end == std::string::npos && !last)
+        break;
+      if (end == std::string::npos)
+        end = buffer.size();
+      line_number++;
+      if (!parse_line(std::string_view(buffer).substr(begin, end - begin)))
+      {
+        std::cerr << "Error: Cannot read line " << line_number << " of " << file_path << "\n";
+        return Circuit();
+      }
+      begin = end + 1;
+    }
+    buffer.erase(0, std::min(begin, buffer.size()));
+  }
+
+  //Shorts merge their nodes. The class of node 0 is rooted at it so that it stays the ground and keeps its name, any
+  //other class takes the lowest id so a merged node keeps the name seen first
+  auto zero = ids.find(std::string_view("0"));
+  const uint32_t ground = zero == ids.end() ? UINT32_MAX : zero->second;
+  std::vector<uint32_t> parent(names.size());
+  for (uint32_t i = 0; i < parent.size(); i++) parent[i] = i;
+  auto is_short = [](const Record &record) { return record.value == 0.0 && record.kind != 'i'; };
+  for (const Record &record : records)
+    if (is_short(record))
+    {
+      uint32_t a = find_root(parent, record.pos);
+      uint32_t b = find_root(parent, record.neg);
+      if (b == ground || (a != ground && b < a))
+        std::swap(a, b);
+      parent[b] = a;
+    }
+
+  Circuit circuit;
+  std::vector<Node *> nodes(names.size(), nullptr);
+  size_t classes = 0;
+  for (uint32_t i = 0; i < parent.size(); i++) classes += find_root(parent, i) == i;
+  circuit.reserve(classes, records.size());
+  for (uint32_t i = 0; i < parent.size(); i++)
+    if (find_root(parent, i) == i)
+    {
+      circuit.add_node(*names[i]);
+      nodes[i] = circuit.nodes().back();
+    }
+  if (ground != UINT32_MAX)
+    circuit.set_ground(nodes[ground]);
+
+  for (const Record &record : records)
+  {
+    Node *pos = nodes[find_root(parent, record.pos)];
+    Node *neg = nodes[find_root(parent, record.neg)];
+    //Shorts are gone, and an element across one merged node carries nothing
+    if (is_short(record) || pos == neg)
+    {
+      if (!is_short(record) && record.kind == 'v')
+        std::cerr << "Warning: Voltage source " << arena.substr(record.name, record.length) << " is shorted, skipped\n";
+      continue;
+    }
+    std::string name = arena.substr(record.name, record.length);
+    bool added = false;
+    if (record.kind == 'r')
+      added = circuit.add_resistor(std::move(name), pos, neg, record.value);
+    else if (record.kind == 'v')
+      added = circuit.add_v_source(std::move(name), pos, neg, record.value);
+    else
+      added = circuit.add_c_source(std::move(name), neg, pos, record.value);  //SPICE drives current from pos to neg
+    if (!added)
+      return Circuit();
+  }
+  return circuit;
+}
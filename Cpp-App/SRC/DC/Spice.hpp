@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "Circuit.hpp"
+
+/**
+ * @class SpiceReader
+ * @brief Reads the SPICE dialect of the IBM power grid benchmarks (ibmpg1 to ibmpg6, ibmpgnew1 and 2) into a circuit.
+ *
+ * Lines hold one R, V or I element as name, two nodes and a value with an optional SPICE scale suffix (k, m, u, meg,
+ * ...); comments (*) and dot commands are skipped, and node 0 is pinned as the ground. The file is scanned in large
+ * blocks with no string per token: node names are interned in one hash map, element names in one arena. Zero-ohm
+ * resistors and zero-volt sources, which the benchmarks use for vias and package shorts and which would make the MNA
+ * matrix singular or badly scaled, are merged away with union-find before the circuit is built; a merged node is
+ * named 0 if node 0 is among them and keeps the name seen first otherwise. Gzip compressed files are read as they are,
+ * see InputFile.
+ */
+class SpiceReader
+{
+public:
+  /**
+     * @brief Reads a netlist.
+     * @param file_path Path of the netlist.
+     * @return The circuit, empty if the file cannot be read or holds an element other than R, V or I.
+     */
+  static Circuit load(const std::string &file_path);
+};
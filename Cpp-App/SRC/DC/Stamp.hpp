@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @enum StampKind
+ * @brief How a stamp's coefficient depends on the value of its element.
+ */
+enum class StampKind
+{
+  CONSTANT,     //coefficient = sign (incidence of voltage sources)
+  CONDUCTANCE,  //coefficient = sign / value (resistors)
+  VALUE,        //coefficient = sign * value (source values, closed switches)
+  COMPLEMENT,   //coefficient = sign * (1 - value) (open switches)
+};
+
+/**
+ * @brief Evaluates the coefficient of a stamp for a given element value.
+ * @param kind Kind of the stamp.
+ * @param sign Sign of the stamp.
+ * @param value Value of the element.
+ * @return Coefficient to add to A or Z.
+ */
+inline double stamp_coefficient(StampKind kind, double sign, double value)
+{
+  switch (kind)
+  {
+    case StampKind::CONDUCTANCE: return sign / value;
+    case StampKind::VALUE: return sign * value;
+    case StampKind::COMPLEMENT: return sign * (1.0 - value);
+    default: return sign;
+  }
+}
+
+/**
+ * @brief Evaluates the derivative of a stamp's coefficient with respect to the value of its element.
+ * @param kind Kind of the stamp.
+ * @param sign Sign of the stamp.
+ * @param value Value of the element.
+ * @return d coefficient / d value.
+ */
+inline double stamp_derivative(StampKind kind, double sign, double value)
+{
+  switch (kind)
+  {
+    case StampKind::CONDUCTANCE: return -sign / (value * value);
+    case StampKind::VALUE: return sign;
+    case StampKind::COMPLEMENT: return -sign;
+    default: return 0.0;
+  }
+}
+
+/**
+ * @struct MatrixStamp
+ * @brief Contribution of an element to one entry of A.
+ */
+struct MatrixStamp
+{
+  size_t row;      ///< Row in A
+  size_t col;      ///< Column in A
+  double sign;     ///< Sign (or constant coefficient) of the contribution
+  size_t element;  ///< Index of the element in the circuit
+  StampKind kind;  ///< How the coefficient depends on the element value
+};
+
+/**
+ * @struct SourceStamp
+ * @brief Contribution of an element to one entry of Z, always sign * value.
+ */
+struct SourceStamp
+{
+  size_t row;      ///< Row in Z
+  double sign;     ///< Sign of the contribution
+  size_t element;  ///< Index of the element in the circuit
+};
+
+/**
+ * @struct StampList
+ * @brief Every contribution of every element to the MNA system A * X = Z.
+ *
+ * The list only depends on the topology, so it can be reused with different element values.
+ */
+struct StampList
+{
+  size_t size = 0;                    ///< Number of unknowns (rows of A)
+  size_t num_nodes = 0;               ///< Number of node voltage unknowns, branch currents follow them
+  std::vector<MatrixStamp> matrix;    ///< Contributions to A, the G of G * X + C * dX/dt = Z
+  std::vector<SourceStamp> sources;   ///< Contributions to Z
+  std::vector<MatrixStamp> reactive;  ///< Contributions to C, unused by DC solves
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Root of the class of i in a union-find forest, halving the path on the way up.
+ * @param parent Parent of each item, a root is its own parent.
+ * @param i Item to look up.
+ * @return Root of the class of i.
+ */
+template <class Index>
+Index find_root(std::vector<Index> &parent, std::type_identity_t<Index> i)
+{
+  while (parent[i] != i)
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
@@ -0,0 +1,282 @@
+#include "Update.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+void LowRankUpdate::reset(const Eigen::SparseMatrix<double> &A, const std::vector<size_t> &row_labels,
+                          const std::vector<size_t> &column_labels)
+{
+  clear();
+  _base = A;
+  _base.makeCompressed();
+  _base_row_labels = row_labels;
+  _base_column_labels = column_labels;
+  for (size_t i = 0; i < row_labels.size(); i++) _base_rows.emplace(row_labels[i], i);
+  for (size_t i = 0; i < column_labels.size(); i++) _base_columns.emplace(column_labels[i], i);
+}
+
+void LowRankUpdate::clear()
+{
+  _base = Eigen::SparseMatrix<double>();
+  _base_row_labels.clear();
+  _base_column_labels.clear();
+  _base_rows.clear();
+  _base_columns.clear();
+  _slots.clear();
+  _slot_rows.clear();
+  _slot_used.clear();
+  _updates = 0;
+  _W.resize(0, 0);
+  _ready = false;
+}
+
+bool LowRankUpdate::solve(const LinearSolver &solver, const Eigen::SparseMatrix<double> &A, const Eigen::VectorXd &Z,
+                          const std::vector<size_t> &row_labels, const std::vector<size_t> &column_labels, Eigen::VectorXd &X)
+{
+  _ready = false;
+  const size_t base_size = _base.rows();
+  const size_t n = A.rows();
+  if (!active() || row_labels.size() != n || column_labels.size() != n)
+    return false;
+
+  _changed.clear();
+  _delta.clear();
+  std::vector<long> position;
+  //Records a nonzero of D, false once more rows changed than an update is worth
+  auto record = [&](size_t row, size_t column, double value)
+  {
+    if (position[row] < 0)
+    {
+      if (_changed.size() == max_rank)
+        return false;
+      position[row] = _changed.size();
+      _changed.push_back(row);
+    }
+    _delta.push_back({size_t(position[row]), column, value});
+    return true;
+  };
+
+  bool same_pattern = row_labels == _base_row_labels && column_labels == _base_column_labels && A.isCompressed() &&
+                      A.nonZeros() == _base.nonZeros() &&
+                      std::equal(A.outerIndexPtr(), A.outerIndexPtr() + A.outerSize() + 1, _base.outerIndexPtr()) &&
+                      std::equal(A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros(), _base.innerIndexPtr());
+  if (same_pattern)
+  {
+    //Same unknowns in the same places, D is the difference of the value arrays
+    _size = n;
+    _rows.resize(n);
+    _columns.resize(n);
+    std::iota(_rows.begin(), _rows.end(), size_t(0));
+    std::iota(_columns.begin(), _columns.end(), size_t(0));
+    position.assign(n, -1);
+    const double *edited = A.valuePtr();
+    const double *base = _base.valuePtr();
+    for (Eigen::Index column = 0; column < A.outerSize(); column++)
+      for (Eigen::Index k = A.outerIndexPtr()[column]; k < A.outerIndexPtr()[column + 1]; k++)
+        if (edited[k] != base[k] && !record(A.innerIndexPtr()[k], column, edited[k] - base[k]))
+          return false;
+  }
+  else
+  {
+    //Position of every row and column of A in the joint space: its base index, or past the base for a new one
+    _rows.resize(n);
+    _columns.resize(n);
+    std::vector<char> row_used(base_size, 0);
+    std::vector<char> column_used(base_size, 0);
+    size_t new_rows = 0;
+    size_t new_columns = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      auto row = _base_rows.find(row_labels[i]);
+      if (row != _base_rows.end() && !row_used[row->second])
+        row_used[_rows[i] = row->second] = 1;
+      else
+        _rows[i] = base_size + new_rows++;
+      auto column = _base_columns.find(column_labels[i]);
+      if (column != _base_columns.end() && !column_used[column->second])
+        column_used[_columns[i] = column->second] = 1;
+      else
+        _columns[i] = base_size + new_columns++;
+    }
+    //Base unknowns the edit removed keep an identity row, pairing base row p with base column p
+    if (new_rows != new_columns)
+      return false;
+    for (size_t p = 0; p < base_size; p++)
+      if (row_used[p] != column_used[p])
+        return false;
+    _size = base_size + new_rows;
+
+    //D = edited - base in the joint space, where the base has an identity block for the new unknowns. Each column is
+    //summed in a dense scratch so that entries the edit left alone cancel without sorting
+    position.assign(_size, -1);
+    std::vector<long> edited_column(_size, -1);
+    for (size_t i = 0; i < n; i++) edited_column[_columns[i]] = i;
+    std::vector<double> sum(_size, 0.0);
+    std::vector<char> touched(_size, 0);
+    std::vector<size_t> entries;
+    auto add = [&](size_t row, double value)
+    {
+      if (!touched[row])
+      {
+        touched[row] = 1;
+        entries.push_back(row);
+      }
+      sum[row] += value;
+    };
+    for (size_t column = 0; column < _size; column++)
+    {
+      if (edited_column[column] >= 0)
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, edited_column[column]); it; ++it) add(_rows[it.row()], it.value());
+      if (column < base_size)
+      {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(_base, column); it; ++it) add(it.row(), -it.value());
+        if (!row_used[column])
+          add(column, 1.0);
+      }
+      else
+        add(column, -1.0);
+      for (size_t row : entries)
+      {
+        if (sum[row] != 0.0 && !record(row, column, sum[row]))
+          return false;
+        sum[row] = 0.0;
+        touched[row] = 0;
+      }
+      entries.clear();
+    }
+  }
+
+  //Columns of W: kept solves for base rows, unit vectors for new rows since the joint base is the identity there
+  const size_t k = _changed.size();
+  _updates++;
+  _changed_slots.assign(k, -1);
+  for (size_t j = 0; j < k; j++)
+  {
+    auto slot = _slots.find(_changed[j]);
+    if (slot != _slots.end())
+      _slot_used[_changed_slots[j] = slot->second] = _updates;
+  }
+  Eigen::VectorXd unit = Eigen::VectorXd::Zero(base_size);
+  Eigen::VectorXd w;
+  for (size_t j = 0; j < k; j++)
+  {
+    size_t r = _changed[j];
+    if (r >= base_size || _changed_slots[j] >= 0)
+      continue;
+    size_t column = _slot_rows.size();
+    if (column < 2 * max_rank)
+    {
+      if (size_t(_W.cols()) == column)
+        _W.conservativeResize(base_size, std::min(2 * max_rank, std::max<size_t>(4, 2 * column)));
+      _slot_rows.push_back(r);
+      _slot_used.push_back(0);
+    }
+    else
+    {
+      //All columns are taken, reuse the least recently used one that this update does not need
+      column = std::min_element(_slot_used.begin(), _slot_used.end()) - _slot_used.begin();
+      _slots.erase(_slot_rows[column]);
+      _slot_rows[column] = r;
+    }
+    unit(r) = 1.0;
+    bool solved = solver.solve(unit, w);
+    unit(r) = 0.0;
+    if (!solved)
+    {
+      _slots.erase(r);
+      _slot_used[column] = 0;
+      _slot_rows[column] = size_t(-1);
+      return false;
+    }
+    _W.col(column) = w;
+    _slots[r] = column;
+    _slot_used[column] = _updates;
+    _changed_slots[j] = column;
+  }
+
+  //K = I + D W, k x k
+  Eigen::MatrixXd K = Eigen::MatrixXd::Identity(k, k);
+  for (const Entry &entry : _delta)
+    for (size_t j = 0; j < k; j++)
+    {
+      if (_changed_slots[j] >= 0)
+        K(entry.position, j) += entry.column < base_size ? entry.value * _W(entry.column, _changed_slots[j]) : 0.0;
+      else if (entry.column == _changed[j])
+        K(entry.position, j) += entry.value;
+    }
+  _lu.compute(K);
+  if (k > 0 && !(_lu.rcond() > 1e-12))
+    return false;
+
+  _ready = finish(solver, A, Z, X);
+  return _ready;
+}
+
+bool LowRankUpdate::resolve(const LinearSolver &solver, const Eigen::SparseMatrix<double> &A, const Eigen::VectorXd &Z,
+                            Eigen::VectorXd &X) const
+{
+  if (!_ready || size_t(A.rows()) != _rows.size())
+    return false;
+  return finish(solver, A, Z, X);
+}
+
+bool LowRankUpdate::apply(const LinearSolver &solver, const Eigen::VectorXd &z, Eigen::VectorXd &x) const
+{
+  //x = A'^-1 z in the joint space
+  const size_t base_size = _base.rows();
+  Eigen::VectorXd top;
+  if (!solver.solve(z.head(base_size), top))
+    return false;
+  x.resize(_size);
+  x.head(base_size) = top;
+  x.tail(_size - base_size) = z.tail(_size - base_size);
+  const size_t k = _changed.size();
+  if (k == 0)
+    return true;
+  Eigen::VectorXd dx = Eigen::VectorXd::Zero(k);
+  for (const Entry &entry : _delta) dx(entry.position) += entry.value * x(entry.column);
+  Eigen::VectorXd t = _lu.solve(dx);
+  for (size_t j = 0; j < k; j++)
+  {
+    if (_changed_slots[j] >= 0)
+      x.head(base_size) -= t(j) * _W.col(_changed_slots[j]);
+    else
+      x(_changed[j]) -= t(j);
+  }
+  return true;
+}
+
+bool LowRankUpdate::finish(const LinearSolver &solver, const Eigen::SparseMatrix<double> &A, const Eigen::VectorXd &Z,
+                           Eigen::VectorXd &X) const
+{
+  const size_t n = A.rows();
+  Eigen::VectorXd joint_z = Eigen::VectorXd::Zero(_size);
+  for (size_t i = 0; i < n; i++) joint_z(_rows[i]) = Z(i);
+  Eigen::VectorXd joint_x;
+  if (!apply(solver, joint_z, joint_x))
+    return false;
+  X.resize(n);
+  for (size_t i = 0; i < n; i++) X(i) = joint_x(_columns[i]);
+
+  //Accepted on its backward error, with one step of refinement against the edited matrix if that is too large
+  double norm = 0.0;
+  for (Eigen::Index outer = 0; outer < A.outerSize(); outer++)
+    for (Eigen::SparseMatrix<double>::InnerIterator it(A, outer); it; ++it) norm = std::max(norm, std::abs(it.value()));
+  auto accurate = [&](const Eigen::VectorXd &residual)
+  {
+    double scale = norm * X.lpNorm<Eigen::Infinity>() + Z.lpNorm<Eigen::Infinity>();
+    return X.allFinite() && residual.lpNorm<Eigen::Infinity>() <= 1e-10 * scale;
+  };
+  Eigen::VectorXd residual = Z - A * X;
+  if (accurate(residual))
+    return true;
+
+  joint_z.setZero();
+  for (size_t i = 0; i < n; i++) joint_z(_rows[i]) = residual(i);
+  Eigen::VectorXd correction;
+  if (!apply(solver, joint_z, correction))
+    return false;
+  for (size_t i = 0; i < n; i++) X(i) += correction(_columns[i]);
+  return accurate(Z - A * X);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "../../Include/Eigen/Dense"
+#include "../../Include/Eigen/SparseCore"
+#include "Solver.hpp"
+
+/**
+ * @class LowRankUpdate
+ * @brief Solves an edited MNA system against the factorization of an earlier one, when the edit touches few rows.
+ *
+ * Unknowns and equations are matched between the two systems by label (a node or branch), not by position, so an edit
+ * that adds or removes unknowns and shifts the ones after them still differs from the base in a few rows only. Both
+ * systems are embedded in one space where the unknowns only one of them has get an identity row; there the edited
+ * matrix is the base plus P * D, P picking the k changed rows and D holding their differences, and Woodbury gives
+ * X = Y - W (I + D W)^-1 D Y with Y = A^-1 Z and W = A^-1 P. When the pattern and the labels match the base, D is read
+ * off the difference of the value arrays; otherwise it is merged column by column. The columns of W are kept across
+ * solves, up to 2 * max_rank of them with the least recently used one reused, so repeated edits around the same nodes
+ * cost two solves against the base factorization and one pass over the matrix, and a new right-hand side alone costs one.
+ */
+class LowRankUpdate
+{
+  //Nonzero of D, by its position among the changed rows
+  struct Entry
+  {
+    size_t position;  ///< Index of the row in _changed
+    size_t column;    ///< Column in the joint space
+    double value;     ///< Edited minus base
+  };
+
+  Eigen::SparseMatrix<double> _base;                 ///< Matrix the solver holds a factorization of, empty if none
+  std::vector<size_t> _base_row_labels;              ///< Label of each row of the base
+  std::vector<size_t> _base_column_labels;           ///< Label of each column of the base
+  std::unordered_map<size_t, size_t> _base_rows;     ///< Row of the base by label
+  std::unordered_map<size_t, size_t> _base_columns;  ///< Column of the base by label
+  std::unordered_map<size_t, size_t> _slots;         ///< Column of _W holding A^-1 e_r, by base row r
+  std::vector<size_t> _slot_rows;                    ///< Base row each column of _W was solved for
+  std::vector<size_t> _slot_used;                    ///< Update that last used each column of _W, the oldest is reused
+  size_t _updates;                                   ///< Number of updates built on this base
+  Eigen::MatrixXd _W;                                ///< Kept solves A^-1 e_r, at most 2 * max_rank columns
+
+  //Last update, kept so that a new right-hand side for the same edited matrix costs one solve and no rebuild
+  bool _ready;                                       ///< The members below describe the matrix of the last solve()
+  size_t _size;                                      ///< Size of the joint space
+  std::vector<size_t> _rows;                         ///< Row of each equation in the joint space
+  std::vector<size_t> _columns;                      ///< Column of each unknown in the joint space
+  std::vector<size_t> _changed;                      ///< Rows of the joint space where D is nonzero
+  std::vector<long> _changed_slots;                  ///< Column of _W for each changed row, -1 for a new row
+  std::vector<Entry> _delta;                         ///< Nonzeros of D
+  Eigen::PartialPivLU<Eigen::MatrixXd> _lu;          ///< Factorization of I + D W
+
+  bool apply(const LinearSolver &solver, const Eigen::VectorXd &z, Eigen::VectorXd &x) const;
+  bool finish(const LinearSolver &solver, const Eigen::SparseMatrix<double> &A, const Eigen::VectorXd &Z, Eigen::VectorXd &X) const;
+
+public:
+  static constexpr size_t max_rank = 32;  ///< Changed rows beyond which refactorizing is cheaper than updating
+
+  LowRankUpdate() : _updates(0), _ready(false), _size(0) {}
+
+  /**
+     * @brief Makes a freshly factorized matrix the base of later updates.
+     * @param A Matrix the solver just factorized.
+     * @param row_labels Label of each row of A.
+     * @param column_labels Label of each column of A.
+     */
+  void reset(const Eigen::SparseMatrix<double> &A, const std::vector<size_t> &row_labels, const std::vector<size_t> &column_labels);
+
+  /**
+     * @brief Forgets the base, when the solver is factorized with something else.
+     */
+  void clear();
+
+  /**
+     * @brief Checks if there is a base to update.
+     */
+  bool active() const { return _base.rows() > 0; }
+
+  /**
+     * @brief Solves an edited system through the base factorization.
+     * @param solver Solver holding the factorization of the base.
+     * @param A Edited matrix.
+     * @param Z Edited right-hand side.
+     * @param row_labels Label of each row of A, equal labels in the base mean the same equation.
+     * @param column_labels Label of each column of A, equal labels in the base mean the same unknown.
+     * @param X Set to the solution of A X = Z.
+     * @return False if the edit changes more than max_rank rows or the update is too inaccurate, then refactorize.
+     */
+  bool solve(const LinearSolver &solver, const Eigen::SparseMatrix<double> &A, const Eigen::VectorXd &Z,
+             const std::vector<size_t> &row_labels, const std::vector<size_t> &column_labels, Eigen::VectorXd &X);
+
+  /**
+     * @brief Solves the matrix of the last successful solve() again, for a right-hand side that changed alone.
+     * @param solver Solver holding the factorization of the base.
+     * @param A Edited matrix, unchanged since that solve().
+     * @param Z New right-hand side.
+     * @param X Set to the solution of A X = Z.
+     * @return False if there is no such update or the solution is too inaccurate, then refactorize.
+     */
+  bool resolve(const LinearSolver &solver, const Eigen::SparseMatrix<double> &A, const Eigen::VectorXd &Z, Eigen::VectorXd &X) const;
+};
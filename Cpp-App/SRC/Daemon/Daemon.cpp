@@ -0,0 +1,372 @@
+#include "Daemon.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+//Print a value so that it reads back to the same double
+static std::string format(double value)
+{
+  std::ostringstream out;
+  out << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+  return out.str();
+}
+
+//Write the whole buffer, false if the other end is gone
+static bool write_all(int fd, const std::string &data)
+{
+  size_t written = 0;
+  while (written < data.size())
+  {
+    ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    written += n;
+  }
+  return true;
+}
+
+Daemon::Daemon(size_t workers) : _workers(workers > 0 ? workers : 1), _stopping(false), _listener(-1) {}
+
+void Daemon::serve_stream(int in, int out)
+{
+  std::string pending;
+  char buffer[4096];
+  bool eof = false;
+  bool close = false;
+  while (!close && !_stopping)
+  {
+    size_t end = pending.find('\n');
+    if (end == std::string::npos)
+    {
+      if (eof)
+        break;
+      ssize_t n = ::read(in, buffer, sizeof(buffer));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+      {
+        //A last request without a line break still gets answered
+        eof = true;
+        if (!pending.empty())
+          pending += '\n';
+        continue;
+      }
+      pending.append(buffer, n);
+      continue;
+    }
+
+    std::string request = pending.substr(0, end);
+    pending.erase(0, end + 1);
+    if (!request.empty() && request.back() == '\r')
+      request.pop_back();
+    if (request.find_first_not_of(" \t") == std::string::npos)
+      continue;
+
+    if (!write_all(out, handle(request, &close) + "\n"))
+      break;
+  }
+
+  if (_stopping)
+    stop();
+}
+
+int Daemon::serve_socket(const std::string &path)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+  {
+    std::cerr << "Socket path too long: " << path << "\n";
+    return 1;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  _listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(path.c_str());
+  if (_listener < 0 || ::bind(_listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(_listener, SOMAXCONN) < 0)
+  {
+    std::cerr << "Cannot listen on " << path << ": " << std::strerror(errno) << "\n";
+    if (_listener >= 0)
+      ::close(_listener);
+    _listener = -1;
+    return 1;
+  }
+
+  //A client that hangs up before reading its reply must not kill the daemon
+  std::signal(SIGPIPE, SIG_IGN);
+
+  std::vector<std::thread> pool;
+  for (size_t i = 0; i < _workers; i++) pool.emplace_back(&Daemon::work, this);
+
+  while (!_stopping)
+  {
+    int client = ::accept(_listener, nullptr, nullptr);
+    if (client < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      //stop() shuts the listener down, which ends accept
+      break;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (_stopping)
+      {
+        ::close(client);
+        break;
+      }
+      _queue.push_back(client);
+    }
+    _queue_ready.notify_one();
+  }
+
+  stop();
+  for (auto &worker : pool) worker.join();
+  ::close(_listener);
+  _listener = -1;
+  ::unlink(path.c_str());
+  return 0;
+}
+
+std::string Daemon::handle(const std::string &request, bool *close)
+{
+  std::istringstream in(request);
+  std::string command;
+  std::string id;
+  in >> command;
+
+  if (command == "quit" || command == "shutdown")
+  {
+    if (command == "shutdown")
+      _stopping = true;
+    if (close != nullptr)
+      *close = true;
+    return "ok";
+  }
+
+  static const std::unordered_set<std::string> commands = {"load", "unload", "solve", "node", "current", "set",
+                                                            "add", "remove", "reconnect", "floating"};
+  if (commands.count(command) == 0)
+    return "error unknown command " + command;
+  if (!(in >> id))
+    return "error missing circuit id";
+
+  try
+  {
+    if (command == "load")
+    {
+      std::string path;
+      std::getline(in >> std::ws, path);
+      if (path.empty())
+        return "error missing path";
+
+      //Parse and compile outside of any lock, requests on other circuits keep going meanwhile
+      auto entry = std::make_shared<Entry>();
+      entry->circuit.load_json(path);
+      //An empty netlist has no node to ground, and a half-added element means the file is not what its author meant
+      if (entry->circuit.nodes().empty())
+        return "error " + path + " has no nodes";
+      std::string half = entry->circuit.half_connected();
+      if (!half.empty())
+        return "error element " + half + " of " + path + " has a missing node";
+      entry->circuit.compile();
+
+      std::lock_guard<std::mutex> lock(_circuits_mutex);
+      _circuits[id] = entry;
+      return "ok";
+    }
+
+    if (command == "unload")
+    {
+      std::lock_guard<std::mutex> lock(_circuits_mutex);
+      return _circuits.erase(id) ? "ok" : "error unknown circuit " + id;
+    }
+
+    std::shared_ptr<Entry> entry = find(id);
+    if (entry == nullptr)
+      return "error unknown circuit " + id;
+
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    Circuit &circuit = entry->circuit;
+
+    if (command == "solve")
+    {
+      if (!circuit.solve())
+        return "error solution not found";
+      std::string reply = "ok";
+      for (auto &fuse : circuit.blown_fuses()) reply += " " + fuse;
+      return reply;
+    }
+
+    if (command == "floating")
+    {
+      std::string reply = "ok";
+      for (auto &node : circuit.floating_nodes()) reply += " " + node;
+      return reply;
+    }
+
+    if (command == "add")
+    {
+      std::string type;
+      std::string name;
+      std::string pos;
+      std::string neg;
+      double value;
+      if (!(in >> type >> name >> pos >> neg >> value))
+        return "error add needs a type, a name, two nodes and a value";
+      static const std::unordered_set<std::string> types = {"RESISTOR", "VOLTAGE_SUPPLY", "CURRENT_SUPPLY", "CAPACITOR",
+                                                            "INDUCTOR", "SWITCH", "FUSE"};
+      if (types.count(type) == 0)
+        return "error cannot add " + type;
+      if (circuit.get_element(name) != nullptr)
+        return "error element " + name + " exists";
+      for (auto &node : {pos, neg})
+        if (circuit.get_node(node) == nullptr)
+          circuit.add_node(node);
+      return circuit.add_element(type, name, pos, neg, value) ? "ok" : "error cannot add " + type + " " + name;
+    }
+
+    std::string name;
+    if (!(in >> name))
+      return "error missing name";
+
+    if (command == "node")
+    {
+      Node *node = circuit.get_node(name);
+      return node != nullptr ? "ok " + format(node->voltage()) : "error unknown node " + name;
+    }
+
+    Element *element = circuit.get_element(name);
+    if (element == nullptr)
+      return "error unknown element " + name;
+
+    if (command == "remove")
+      return circuit.remove_element(name) ? "ok" : "error cannot remove " + name;
+
+    if (command == "reconnect")
+    {
+      std::string terminal;
+      std::string node;
+      if (!(in >> terminal >> node) || (terminal != "pos" && terminal != "neg"))
+        return "error reconnect needs pos or neg and a node";
+      if (circuit.get_node(node) == nullptr)
+        circuit.add_node(node);
+      return circuit.reconnect(name, terminal == "pos" ? Terminal::POS : Terminal::NEG, node) ? "ok" : "error cannot reconnect " + name;
+    }
+
+    if (command == "current")
+    {
+      switch (element->type())
+      {
+        case Type::RESISTOR: return "ok " + format(static_cast<Resistor *>(element)->get_current());
+        case Type::VOLTAGE_SUPPLY: return "ok " + format(static_cast<VoltageSource *>(element)->get_current());
+        case Type::CURRENT_SOURCE: return "ok " + format(static_cast<CurrentSource *>(element)->current());
+        case Type::DEPENDENT_VOLTAGE_SOURCE:
+        case Type::DEPENDENT_CURRENT_SOURCE: return "ok " + format(static_cast<DependentSource *>(element)->get_current());
+        case Type::INDUCTOR: return "ok " + format(static_cast<Inductor *>(element)->get_current());
+        case Type::SWITCH:
+        case Type::FUSE: return "ok " + format(static_cast<Switch *>(element)->get_current());
+        case Type::CAPACITOR: return "ok " + format(0.0);
+        default: return "error no current for " + name;
+      }
+    }
+
+    if (command == "set")
+    {
+      double value;
+      if (!(in >> value))
+        return "error missing value";
+      switch (element->type())
+      {
+        case Type::RESISTOR:
+          if (value <= 0)
+            return "error resistance must be positive";
+          static_cast<Resistor *>(element)->set_resistance(value);
+          return "ok";
+        case Type::VOLTAGE_SUPPLY: static_cast<VoltageSource *>(element)->set_voltage(value); return "ok";
+        case Type::CURRENT_SOURCE: static_cast<CurrentSource *>(element)->set_current(value); return "ok";
+        case Type::DEPENDENT_VOLTAGE_SOURCE:
+        case Type::DEPENDENT_CURRENT_SOURCE: static_cast<DependentSource *>(element)->set_gain(value); return "ok";
+        case Type::CAPACITOR: static_cast<Capacitor *>(element)->set_capacitance(value); return "ok";
+        case Type::INDUCTOR: static_cast<Inductor *>(element)->set_inductance(value); return "ok";
+        case Type::SWITCH: static_cast<Switch *>(element)->set_closed(value != 0.0); return "ok";
+        case Type::FUSE:
+          if (value <= 0)
+            return "error rating must be positive";
+          static_cast<Fuse *>(element)->replace(value);
+          return "ok";
+        default: return "error cannot set " + name;
+      }
+    }
+  }
+  catch (const std::exception &e)
+  {
+    //Parse errors of load, a bad netlist must not take the daemon down
+    std::string message = e.what();
+    std::replace(message.begin(), message.end(), '\n', ' ');
+    return "error " + message;
+  }
+
+  return "error missing name";
+}
+
+std::shared_ptr<Daemon::Entry> Daemon::find(const std::string &id)
+{
+  std::lock_guard<std::mutex> lock(_circuits_mutex);
+  auto it = _circuits.find(id);
+  return it != _circuits.end() ? it->second : nullptr;
+}
+
+void Daemon::work()
+{
+  while (true)
+  {
+    int client;
+    {
+      std::unique_lock<std::mutex> lock(_queue_mutex);
+      _queue_ready.wait(lock, [this] { return _stopping || !_queue.empty(); });
+      if (_stopping)
+        return;
+      client = _queue.front();
+      _queue.pop_front();
+      _connections.insert(client);
+    }
+
+    serve_stream(client, client);
+
+    {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      _connections.erase(client);
+    }
+    ::close(client);
+  }
+}
+
+void Daemon::stop()
+{
+  _stopping = true;
+  {
+    std::lock_guard<std::mutex> lock(_queue_mutex);
+    for (int client : _queue) ::close(client);
+    _queue.clear();
+    //Wakes workers blocked reading from idle clients
+    for (int client : _connections) ::shutdown(client, SHUT_RDWR);
+  }
+  if (_listener >= 0)
+    ::shutdown(_listener, SHUT_RDWR);
+  _queue_ready.notify_all();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../DC/Circuit.hpp"
+
+/**
+ * @class Daemon
+ * @brief Keeps parsed and compiled circuits resident and answers requests about them, one request per line.
+ *
+ * Requests and their replies (every reply is one line, "ok ..." or "error <message>"):
+ *   load <id> <path>           parse a JSON netlist and keep it under id, replacing any previous one; a netlist
+ *                              without nodes or with an element missing a node is refused
+ *   set <id> <element> <value> change the value of an element: 1 closes a switch and 0 opens it, a fuse is replaced by one
+ *                              of that rating
+ *   add <id> <type> <name> <pos> <neg> <value>
+ *                              add a RESISTOR, VOLTAGE_SUPPLY, CURRENT_SUPPLY, CAPACITOR, INDUCTOR, SWITCH or FUSE,
+ *                              creating new nodes
+ *   remove <id> <element>      delete an element, and the nodes it leaves without elements
+ *   reconnect <id> <element> pos|neg <node>
+ *                              move one terminal of an element to another node, creating it if new and deleting the
+ *                              old one if it is left without elements
+ *   floating <id>              nodes with no path of resistors or sources to the ground, a singular system
+ *   solve <id>                 solve with the current values, only changed elements are restamped; replies with the
+ *                              names of the fuses that blew
+ *   node <id> <node>           voltage of a node from the last solve
+ *   current <id> <element>     current through an element from the last solve
+ *   unload <id>                forget a circuit
+ *   quit                       close this connection
+ *   shutdown                   stop the daemon
+ *
+ * Circuits are shared by every connection. Each one has its own mutex, so clients working on different circuits never
+ * wait for each other.
+ */
+class Daemon
+{
+  /**
+     * @struct Entry
+     * @brief A resident circuit and the lock that serializes requests on it.
+     */
+  struct Entry
+  {
+    std::mutex mutex;  ///< Held while a request reads or changes the circuit
+    Circuit circuit;   ///< Compiled circuit
+  };
+
+  size_t _workers;                                                   ///< Connections served at the same time
+  std::mutex _circuits_mutex;                                        ///< Guards _circuits
+  std::unordered_map<std::string, std::shared_ptr<Entry>> _circuits;  ///< Resident circuits by id
+  std::atomic<bool> _stopping;                                       ///< Set by shutdown
+  std::mutex _queue_mutex;                                           ///< Guards _queue and _connections
+  std::condition_variable _queue_ready;                              ///< Signals a queued connection or a shutdown
+  std::deque<int> _queue;                                            ///< Accepted connections waiting for a worker
+  std::unordered_set<int> _connections;                              ///< Connections being served, closed on shutdown
+  int _listener;                                                     ///< Listening socket, -1 when serving a stream
+
+public:
+  /**
+     * @brief Constructor for Daemon.
+     * @param workers Number of connections served at the same time by serve_socket, others wait in a queue.
+     */
+  explicit Daemon(size_t workers = 4);
+
+  Daemon(const Daemon &) = delete;
+  Daemon &operator=(const Daemon &) = delete;
+
+  /**
+     * @brief Answers requests read from a file descriptor until end of input, quit or shutdown.
+     * @param in Descriptor to read requests from, e.g. 0 for stdin.
+     * @param out Descriptor to write replies to, e.g. 1 for stdout.
+     */
+  void serve_stream(int in, int out);
+
+  /**
+     * @brief Listens on a Unix domain socket and serves clients with a pool of worker threads until shutdown.
+     * @param path Path of the socket, an existing file there is replaced.
+     * @return 0 after shutdown, 1 if the socket could not be set up.
+     */
+  int serve_socket(const std::string &path);
+
+  /**
+     * @brief Answers one request.
+     * @param request Request line, without the line break.
+     * @param close Set to true when the request ends the connection (quit or shutdown).
+     * @return Reply line, without the line break.
+     */
+  std::string handle(const std::string &request, bool *close = nullptr);
+
+private:
+  /**
+     * @brief Gets a resident circuit.
+     * @param id Id given to load.
+     * @return The circuit, nullptr if no circuit has that id.
+     */
+  std::shared_ptr<Entry> find(const std::string &id);
+
+  /**
+     * @brief Worker loop of serve_socket: takes queued connections and serves them until shutdown.
+     */
+  void work();
+
+  /**
+     * @brief Stops accepting, wakes the workers and closes the connections they serve.
+     */
+  void stop();
+};
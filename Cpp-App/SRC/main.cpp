@@ -1,14 +1,202 @@
 // Solving circuits using MODIFIED NODAL ANALYSIS (MNA)
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+#include <fstream>
+
+#include "./BatchRun/BatchRun.hpp"
+#include "./DC/Board.hpp"
 #include "./DC/Circuit.hpp"
+#include "./DC/Spice.hpp"
+#include "./Daemon/Daemon.hpp"
 
 // TODO: Add both nodes at once
 // DOUBT: I am not sure if I should add both nodes at once or not but we'll see after developing frontend
 // TODO: Add current sources and dependent sources
 // TODO: Add more error handling, optimize code and add more error messages
 
-int main()
+static int usage(const char *program)
+{
+  std::cerr << "Usage: " << program << " [--verbose] [--profile] [--mixed] [--backend <name>] [--cache <dir>] [--cache-size <MiB>]\n"
+            << "         [--board <file> | --spice <file> | --batch <dir|list> [--threads <n>] [--output <file>] |\n"
+            << "          --daemon [--socket <path>] [--workers <n>]]\n";
+  return 1;
+}
+
+//A whole argument as a decimal count, so that a typo is refused instead of read as 0
+static bool parse_count(const char *text, unsigned long long &value)
+{
+  const char *end = text + std::strlen(text);
+  auto [last, error] = std::from_chars(text, end, value);
+  return error == std::errc() && last == end && last != text;
+}
+
+int main(int argc, char **argv)
 {
-  Circuit c = Circuit::create_from_json("./SRC/Circuit.json");
+  bool verbose = false;
+  bool profile = false;
+  bool mixed = false;
+  bool daemon = false;
+  std::string socket;
+  size_t workers = 4;
+  std::string batch;
+  std::string board;
+  std::string spice;
+  std::string output = "results.json";
+  size_t threads = 0;
+  std::string cache_dir;
+  uintmax_t cache_size = uintmax_t(64) << 20;
+  Backend backend = Backend::AUTO;
+  unsigned long long count = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--verbose") == 0)
+      verbose = true;
+    else if (std::strcmp(argv[i], "--profile") == 0)
+      profile = true;
+    else if (std::strcmp(argv[i], "--mixed") == 0)
+      mixed = true;
+    else if (std::strcmp(argv[i], "--daemon") == 0)
+      daemon = true;
+    else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+      socket = argv[++i];
+    else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+    {
+      if (!parse_count(argv[++i], count) || count == 0)
+      {
+        std::cerr << "Invalid worker count: " << argv[i] << "\n";
+        return usage(argv[0]);
+      }
+      workers = count;
+    }
+    else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+      batch = argv[++i];
+    else if (std::strcmp(argv[i], "--board") == 0 && i + 1 < argc)
+      board = argv[++i];
+    else if (std::strcmp(argv[i], "--spice") == 0 && i + 1 < argc)
+      spice = argv[++i];
+    else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+      output = argv[++i];
+    else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+    {
+      if (!parse_count(argv[++i], count))
+      {
+        std::cerr << "Invalid thread count: " << argv[i] << "\n";
+        return usage(argv[0]);
+      }
+      threads = count;
+    }
+    else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+      cache_dir = argv[++i];
+    else if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+    {
+      if (!parse_count(argv[++i], count) || count > (std::numeric_limits<uintmax_t>::max() >> 20))
+      {
+        std::cerr << "Invalid cache size: " << argv[i] << "\n";
+        return usage(argv[0]);
+      }
+      cache_size = uintmax_t(count) << 20;
+    }
+    else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+    {
+      if (!backend_from_name(argv[++i], backend))
+      {
+        std::cerr << "Unknown backend: " << argv[i] << "\n";
+        return 1;
+      }
+    }
+    else
+    {
+      //Also an option whose value is missing at the end of the line
+      std::cerr << "Unknown option or missing value: " << argv[i] << "\n";
+      return usage(argv[0]);
+    }
+  }
+
+  std::unique_ptr<ResultCache> cache;
+  if (!cache_dir.empty())
+    cache = std::make_unique<ResultCache>(cache_dir, cache_size);
+
+  //Keep circuits resident and answer requests on stdin or a Unix socket instead of solving one file
+  if (daemon)
+  {
+    Daemon server(workers);
+    if (socket.empty())
+    {
+      server.serve_stream(0, 1);
+      return 0;
+    }
+    return server.serve_socket(socket);
+  }
+
+  //Solve every netlist of a directory or list file on a pool of threads into one results file
+  if (!batch.empty())
+  {
+    std::vector<std::string> files = batch_inputs(batch);
+    if (files.empty())
+    {
+      std::cerr << "No netlists found in " << batch << "\n";
+      return 1;
+    }
+    std::ofstream out(output);
+    if (!out)
+    {
+      std::cerr << "Cannot write " << output << "\n";
+      return 1;
+    }
+    return run_batch(files, {threads, backend, mixed, cache.get()}, out) == 0 ? 0 : 1;
+  }
+
+  //Read an IBM power grid benchmark and report its timings instead of dumping a circuit of millions of nodes
+  if (!spice.empty())
+  {
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    Circuit c = SpiceReader::load(spice);
+    auto read = clock::now();
+    if (c.nodes().empty())
+      return 1;
+    c.enable_profiling(profile);
+    c.set_backend(backend);
+    c.set_mixed_precision(mixed);
+    bool solved = c.solve();
+    auto end = clock::now();
+
+    double low = std::numeric_limits<double>::infinity();
+    double high = -low;
+    for (auto node : c.nodes())
+      if (!node->is_ground())
+      {
+        low = std::min(low, node->voltage());
+        high = std::max(high, node->voltage());
+      }
+    std::cout << spice << ": " << c.nodes().size() << " nodes, " << c.elements().size() << " elements, read "
+              << std::chrono::duration<double, std::milli>(read - start).count() << " ms, solve "
+              << std::chrono::duration<double, std::milli>(end - read).count() << " ms, backend " << backend_name(c.backend())
+              << ", voltages " << low << " to " << high << (solved ? "" : ", NOT SOLVED") << "\n";
+    if (profile)
+      std::cout << "PROFILE: " << c.profile().to_json() << "\n";
+    return solved ? 0 : 1;
+  }
+
+  //A board saved by the diagram editor instead of the JSON netlist
+  Circuit c = board.empty() ? Circuit::create_from_json("./SRC/Circuit.json", profile) : BoardImporter::load(board);
+  if (!board.empty() && c.nodes().empty())
+    return 1;
+  c.enable_profiling(profile);
+  c.set_verbose(verbose);
+  c.set_backend(backend);
+  c.set_mixed_precision(mixed);
+  c.set_cache(cache.get());
   c.solve();
   c.check();
+
+  std::cout << "\nBackend: " << (c.from_cache() ? "cache" : backend_name(c.backend())) << "\n";
+  if (profile)
+    std::cout << "\nPROFILE: " << c.profile().to_json() << "\n";
 }
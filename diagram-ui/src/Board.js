@@ -512,6 +512,33 @@ export class Board {
     );
   }
 
+  // Elements are referenced by id, this is the format the C++ BoardImporter reads
+  serialize() {
+    const terminal = (t) => ({
+      type: t.type,
+      connections: t.connections.map((e) => e.id),
+    });
+    return JSON.stringify({
+      elements: this.elements.map((e) => ({
+        id: e.id,
+        type: e.type,
+        gridX: e.gridX,
+        gridY: e.gridY,
+        terminals: {
+          left: terminal(e.terminals.left),
+          right: terminal(e.terminals.right),
+        },
+      })),
+      wires: this.wires.map((w) => ({
+        segments: w.segments,
+        beginElement: w.beginElement ? w.beginElement.id : null,
+        beginElementSide: w.beginElementSide,
+        endElement: w.endElement ? w.endElement.id : null,
+        endElementSide: w.endElementSide,
+      })),
+    });
+  }
+
   updateCanvasSize(width, height) {
     this.canvas.width = width;
     this.canvas.height = height;
@@ -24,6 +24,18 @@ const Canvastry = () => {
     boardRef.current.logInfo();
   };
 
+  // Downloads the board in the format ./build/main --board reads
+  const saveBoard = () => {
+    const blob = new Blob([boardRef.current.serialize()], {
+      type: "application/json",
+    });
+    const link = document.createElement("a");
+    link.href = URL.createObjectURL(blob);
+    link.download = "board.json";
+    link.click();
+    URL.revokeObjectURL(link.href);
+  };
+
   useEffect(() => {
     const canvas = canvasRef.current;
     if (!canvas) return;
@@ -123,6 +135,7 @@ const Canvastry = () => {
             <span>Resistor</span>
           </div>
           <button onClick={logInfo}>info</button>
+          <button onClick={saveBoard}>save</button>
         </div>
       </div>
     </div>